@@ -0,0 +1,47 @@
+#include "bench_common.h"
+#include <iomanip>
+#include <dis86_decode_cache.h>
+
+// decodes the image `reps` times, through cache if it isn't null, and
+// returns ns per instruction
+static f64 BenchDecode(const std::vector<u8>& image, u32 reps, DecodeCache *cache) {
+    u64 numInsts = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < reps; i++) {
+        InstStream instStream(ByteSpan{image.data(), image.size()});
+        instStream.SetDecodeCache(cache);
+        while (instStream.NextInstruction()) {
+            numInsts++;
+        }
+    }
+    return SecondsSince(start) * 1e9 / numInsts;
+}
+
+static void BenchCache(const std::string& name, const std::vector<u8>& image, u32 reps) {
+    f64 plainNs = BenchDecode(image, reps, nullptr);
+    // a cache per input, as if each input was its own run
+    DecodeCache cache;
+    f64 cachedNs = BenchDecode(image, reps, &cache);
+    f64 hitRate = (f64)cache.GetHits() / (cache.GetHits() + cache.GetMisses());
+
+    std::cout << "  " << std::left << std::setw(16) << name << std::right << std::fixed
+              << std::setprecision(2) << std::setw(10) << plainNs << std::setw(10) << cachedNs
+              << std::setw(9) << hitRate * 100 << "%" << std::setw(9) << plainNs / cachedNs
+              << "x\n";
+}
+
+void RunCacheBench(const std::vector<InstMix>& mixes, const BenchOptions& options) {
+    std::cout << "decode cache (" << options.size << " bytes x " << options.reps << ", "
+              << DEFAULT_DECODE_CACHE_SETS << " sets x " << DECODE_CACHE_WAYS << " ways)\n"
+              << "  input             ns/inst    cached      hits  speedup\n";
+    // real code repeats a lot more than the synthetic streams, which pick
+    // registers, displacements and immediates at random
+    std::vector<u8> file;
+    if (ReadWholeFile(DIS86_ASM_DIR "/all_supported", file)) {
+        BenchCache("all_supported", RepeatToSize(file, options.size), options.reps);
+    }
+    for (const InstMix& mix : mixes) {
+        BenchCache(mix.name, GenerateStream(mix, options.size, options.seed), options.reps);
+    }
+    std::cout << std::flush;
+}
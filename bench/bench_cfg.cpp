@@ -0,0 +1,37 @@
+#include "bench_common.h"
+#include <dis86_cfg.h>
+
+void RunCfgBench(const std::vector<u8>& image, u32 reps) {
+    // decoded up front so only the graph build is timed
+    std::vector<Instruction> insts;
+    InstStream instStream(ByteSpan{image.data(), image.size()});
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        insts.push_back(inst);
+    }
+
+    f64 seconds = 0;
+    u64 numBlocks = 0;
+    u64 numEdges = 0;
+    u64 memory = 0;
+    for (u32 i = 0; i < reps; i++) {
+        auto start = std::chrono::steady_clock::now();
+        ControlFlowGraph cfg;
+        for (const Instruction& inst : insts) {
+            cfg.AddInstruction(inst);
+        }
+        cfg.Build();
+        seconds += SecondsSince(start);
+        numBlocks = cfg.NumBlocks();
+        numEdges = cfg.NumEdges();
+        memory = cfg.MemoryUsage();
+    }
+
+    f64 millions = insts.size() / 1e6;
+    std::cout << "control flow graph (" << insts.size() << " instructions x " << reps << ")\n"
+              << "  " << numBlocks << " blocks, " << numEdges << " edges\n"
+              << "  build: " << seconds / reps / millions * 1e3 << " ms per 1M instructions\n"
+              << "  graph: " << memory / millions / (1024 * 1024)
+              << " MiB per 1M instructions\n"
+              << std::flush;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <dis86_num_types.h>
+#include <dis86_instruction_stream.h>
+#include <dis86_batch.h>
+
+// repeats file until the image is about targetSize bytes
+static inline std::vector<u8> RepeatToSize(const std::vector<u8>& file, u64 targetSize) {
+    std::vector<u8> image;
+    while (image.size() + file.size() <= targetSize) {
+        image.insert(image.end(), file.begin(), file.end());
+    }
+    return image;
+}
+
+static inline f64 SecondsSince(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<f64> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+// classes of instructions the synthetic streams are built from
+enum class InstClass : u8 {
+    MOV,      // mov reg/mem, immediate to reg and immediate to reg/mem
+    ALU_IMM,  // add/adc/sbb/sub/cmp with immediates
+    SHIFT,    // shift and rotate group
+    ONE_BYTE, // push/pop reg, inc/dec reg, cbw, xlat, ...
+    MEMORY,   // reg <-> mem with each displacement form
+    BRANCH,   // jcc, jmp, call, loop and ret
+    NUM,
+};
+
+// relative weight of each class in a stream
+struct InstMix {
+    const char *name;
+    std::array<u32, (u32)InstClass::NUM> weights;
+};
+
+extern const InstMix INST_MIXES[];
+extern const u32 NUM_INST_MIXES;
+
+// takes a preset name or class=weight,class=weight,...
+bool ParseInstMix(const std::string& str, InstMix& mix);
+// same mix, size and seed always give the same bytes
+std::vector<u8> GenerateStream(const InstMix& mix, u64 size, u32 seed);
+
+struct BenchOptions {
+    u64 size = 4 * 1024 * 1024;
+    u32 reps = 5;
+    u32 seed = 8086;
+    bool json = false;
+};
+
+struct BenchResult {
+    std::string mix;
+    std::string mode;
+    u64 numBytes;
+    u64 numInsts;
+    f64 seconds;
+
+    f64 MBPerSec() const { return numBytes / seconds / (1024 * 1024); }
+    f64 InstPerSec() const { return numInsts / seconds; }
+    f64 NsPerInst() const { return seconds * 1e9 / numInsts; }
+};
+
+// decode only, decode + format into memory, mmap + decode + format + write
+// to the null device, and the two pass --labels output, for one mix
+std::vector<BenchResult> RunSuite(const InstMix& mix, const BenchOptions& options);
+void PrintResults(const std::vector<BenchResult>& results, bool json);
+
+void RunDecodeBench(const std::vector<u8>& image, u32 reps);
+void RunFormatBench(const std::vector<u8>& image, u32 reps);
+void RunParallelBench(const std::vector<u8>& image, u32 reps);
+void RunTraversalBench(const std::vector<u8>& image, u32 reps);
+void RunCfgBench(const std::vector<u8>& image, u32 reps);
+void RunScanBench(const std::vector<u8>& image, u32 reps);
+// writing --format bin records against text, then reading them in and out of order
+void RunInstFileBench(const std::vector<u8>& image, u32 reps);
+// requests from 1 to 4 x hardware threads clients against an in process
+// server, with p50/p99 latency
+void RunServerBench(const std::vector<u8>& image);
+// decode with and without a DecodeCache on a real file and on each mix
+void RunCacheBench(const std::vector<InstMix>& mixes, const BenchOptions& options);
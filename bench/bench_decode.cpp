@@ -0,0 +1,42 @@
+#include "bench_common.h"
+#include <dis86_instruction_stream.h>
+
+// decodes the whole image `reps` times and returns instructions per second,
+// counters are those of the last pass
+template<typename DecodeFn>
+static f64 BenchDecode(const std::vector<u8>& image, u32 reps, DecodeCounters& counters,
+                       DecodeFn decode) {
+    u64 numInsts = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < reps; i++) {
+        InstStream instStream(ByteSpan{image.data(), image.size()});
+        while (decode(instStream)) {
+            numInsts++;
+        }
+        counters = instStream.GetDecodeCounters();
+    }
+    return numInsts / SecondsSince(start);
+}
+
+static void PrintCounters(const char *name, const DecodeCounters& counters) {
+    f64 numInsts = (f64)std::max<u64>(counters.numInsts, 1);
+    std::cout << "  " << name << counters.numProbes / numInsts << " probes, "
+              << counters.numAttempts / numInsts << " attempts per instruction\n";
+}
+
+void RunDecodeBench(const std::vector<u8>& image, u32 reps) {
+    DecodeCounters linearCounters;
+    DecodeCounters generatedCounters;
+    f64 linear = BenchDecode(image, reps, linearCounters,
+        [](InstStream& s) { return (bool)s.NextInstructionLinear(); });
+    f64 generated = BenchDecode(image, reps, generatedCounters,
+        [](InstStream& s) { return (bool)s.NextInstruction(); });
+
+    std::cout << "decode (" << image.size() << " bytes x " << reps << ")\n";
+    std::cout << "  linear scan:    " << (u64)linear << " inst/s\n";
+    std::cout << "  generated:      " << (u64)generated << " inst/s\n";
+    std::cout << "  speedup:        " << generated / linear << "x\n";
+    PrintCounters("linear scan:    ", linearCounters);
+    PrintCounters("generated:      ", generatedCounters);
+    std::cout << std::flush;
+}
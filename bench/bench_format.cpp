@@ -0,0 +1,51 @@
+#include "bench_common.h"
+#include <dis86_instruction_stream.h>
+#include <dis86_output_buffer.h>
+
+// the std::string building and per line flushing Instruction::Print used to do
+static void PrintWithStrings(const Instruction& inst, std::ostream& out) {
+    std::string operandStrs[2] = {
+        inst.GetOperand(0).GetStr(),
+        inst.GetOperand(1).GetStr(),
+    };
+    std::string sep = operandStrs[1].empty() ? "" : ", ";
+    std::string instStr = std::string(inst.GetOpStr()) + " " + operandStrs[0] + sep + operandStrs[1];
+    out << instStr << std::endl;
+}
+
+// formats every instruction `reps` times and returns lines per second
+template<typename FormatFn>
+static f64 BenchFormat(const std::vector<Instruction>& insts, u32 reps, FormatFn format) {
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < reps; i++) {
+        for (const Instruction& inst : insts) {
+            format(inst);
+        }
+    }
+    return (f64)insts.size() * reps / SecondsSince(start);
+}
+
+void RunFormatBench(const std::vector<u8>& image, u32 reps) {
+    std::vector<Instruction> insts;
+    InstStream instStream(ByteSpan{image.data(), image.size()});
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        insts.push_back(inst);
+    }
+
+    std::ofstream nullFile(NULL_DEVICE, std::ios::binary);
+    f64 strings = BenchFormat(insts, reps,
+        [&](const Instruction& inst) { PrintWithStrings(inst, nullFile); });
+
+    f64 buffered;
+    {
+        OutputBuffer out(&nullFile);
+        buffered = BenchFormat(insts, reps,
+            [&](const Instruction& inst) { inst.Format(out); });
+    }
+
+    std::cout << "format to " NULL_DEVICE " (" << insts.size() << " lines x " << reps << ")\n";
+    std::cout << "  strings + endl: " << (u64)strings << " lines/s\n";
+    std::cout << "  OutputBuffer:   " << (u64)buffered << " lines/s\n";
+    std::cout << "  speedup:        " << buffered / strings << "x" << std::endl;
+}
@@ -0,0 +1,75 @@
+#include "bench_common.h"
+#include <dis86_inst_file.h>
+#include <dis86_output_buffer.h>
+#include <algorithm>
+#include <random>
+
+// writes every instruction `reps` times into out and returns records per second
+static f64 BenchWrite(const std::vector<Instruction>& insts, u32 reps, OutputFormat format,
+                      OutputBuffer& out) {
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < reps; i++) {
+        out.Clear();
+        for (const Instruction& inst : insts) {
+            // the listing bytes aren't needed by either format
+            inst.Format(out, format, nullptr);
+        }
+    }
+    return (f64)insts.size() * reps / SecondsSince(start);
+}
+
+// reads the records in the given order `reps` times, returns records per second
+static f64 BenchRead(const InstFileReader& reader, const std::vector<u64>& order, u32 reps,
+                     u64& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    Instruction inst;
+    for (u32 i = 0; i < reps; i++) {
+        for (u64 idx : order) {
+            if (reader.GetInst(idx, inst)) {
+                checksum += inst.GetOffset() + (u8)inst.GetOpType();
+            }
+        }
+    }
+    return (f64)order.size() * reps / SecondsSince(start);
+}
+
+void RunInstFileBench(const std::vector<u8>& image, u32 reps) {
+    std::vector<Instruction> insts;
+    InstStream instStream(ByteSpan{image.data(), image.size()});
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        insts.push_back(inst);
+    }
+
+    OutputBuffer text;
+    f64 textRate = BenchWrite(insts, reps, OutputFormat::TEXT, text);
+    OutputBuffer records;
+    f64 writeRate = BenchWrite(insts, reps, OutputFormat::BINARY, records);
+
+    OutputBuffer file;
+    WriteInstFileHeader(file);
+    file.Write(records.Data(), records.Size());
+    InstFileReader reader;
+    if (!reader.Open(ByteSpan{(const u8 *)file.Data(), file.Size()})) {
+        std::cerr << "could not read back the records" << std::endl;
+        return;
+    }
+
+    std::vector<u64> order(reader.GetNumInsts());
+    for (u64 i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    u64 checksum = 0;
+    f64 sequentialRate = BenchRead(reader, order, reps, checksum);
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(8086));
+    f64 randomRate = BenchRead(reader, order, reps, checksum);
+
+    std::cout << "instruction file (" << insts.size() << " instructions x " << reps << ")\n";
+    std::cout << "  write text:       " << (u64)textRate << " inst/s, "
+              << text.Size() << " bytes\n";
+    std::cout << "  write records:    " << (u64)writeRate << " inst/s, "
+              << file.Size() << " bytes\n";
+    std::cout << "  read sequential:  " << (u64)sequentialRate << " inst/s\n";
+    std::cout << "  read random:      " << (u64)randomRate << " inst/s"
+              << " (checksum " << checksum % 1000 << ")" << std::endl;
+}
@@ -0,0 +1,126 @@
+#include "bench_common.h"
+#include <cstring>
+
+static void PrintUsage() {
+    std::cerr <<
+        "usage: dis86_bench [suite|decode|format|parallel|traversal|cfg|cache|server|scan|inst_file] [options]\n"
+        "  suite     decode, decode+format and end to end numbers per mix (default)\n"
+        "  decode    linear scan against the generated decoders\n"
+        "  format    string formatting against OutputBuffer\n"
+        "  parallel  --threads scaling\n"
+        "  traversal recursive traversal scaling from 1 to all hardware threads\n"
+        "  cfg       control flow graph build time and memory, on the branch mix\n"
+        "            unless --mix or --file is given\n"
+        "  cache     decoding with and without the decode cache, per mix\n"
+        "  server    load test of --serve over a unix socket, p50/p99 latency\n"
+        "  scan      pre-scan throughput per instruction set against decoding\n"
+        "  inst_file --format bin records written against text, and read back\n"
+        "options:\n"
+        "  --mix NAME|class=weight,...  synthetic stream to use, may be repeated\n"
+        "                               (mov, alu_imm, shift, one_byte, memory, branch, mixed)\n"
+        "  --file PATH                  use a file instead (repeated to --size)\n"
+        "  --size BYTES                 stream size, default 4 MiB\n"
+        "  --reps N                     passes over the stream, default 5\n"
+        "  --seed N                     generator seed, default 8086\n"
+        "  --json                       machine readable suite output\n";
+}
+
+int main(int argc, char **argv) {
+    std::string which = "suite";
+    std::vector<InstMix> mixes;
+    std::string path;
+    BenchOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--mix") == 0 && hasValue) {
+            InstMix mix;
+            if (!ParseInstMix(argv[++i], mix)) {
+                std::cerr << "bad mix " << argv[i] << std::endl;
+                return 1;
+            }
+            mixes.push_back(mix);
+        } else if (std::strcmp(argv[i], "--file") == 0 && hasValue) {
+            path = argv[++i];
+        } else if (std::strcmp(argv[i], "--size") == 0 && hasValue) {
+            options.size = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--reps") == 0 && hasValue) {
+            options.reps = std::max<u32>(std::stoul(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options.seed = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--json") == 0) {
+            options.json = true;
+        } else if (i == 1 && argv[i][0] != '-') {
+            which = argv[i];
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (which == "suite") {
+        if (mixes.empty()) {
+            mixes.assign(INST_MIXES, INST_MIXES + NUM_INST_MIXES);
+        }
+        std::vector<BenchResult> results;
+        for (const InstMix& mix : mixes) {
+            std::vector<BenchResult> mixResults = RunSuite(mix, options);
+            results.insert(results.end(), mixResults.begin(), mixResults.end());
+        }
+        PrintResults(results, options.json);
+        return 0;
+    }
+    if (which == "cache") {
+        if (mixes.empty()) {
+            mixes.assign(INST_MIXES, INST_MIXES + NUM_INST_MIXES);
+        }
+        RunCacheBench(mixes, options);
+        return 0;
+    }
+
+    // all_supported has almost no branches, so its graph is a single block
+    if (which == "cfg" && path.empty() && mixes.empty()) {
+        InstMix mix;
+        ParseInstMix("branch", mix);
+        mixes.push_back(mix);
+    }
+
+    std::vector<u8> image;
+    if (!path.empty() || mixes.empty()) {
+        if (path.empty()) {
+            path = DIS86_ASM_DIR "/all_supported";
+        }
+        std::vector<u8> file;
+        if (!ReadWholeFile(path, file) || file.empty()) {
+            std::cerr << "could not read " << path << std::endl;
+            return 1;
+        }
+        image = RepeatToSize(file, options.size);
+        std::cout << path << "\n";
+    } else {
+        image = GenerateStream(mixes[0], options.size, options.seed);
+        std::cout << "mix " << mixes[0].name << "\n";
+    }
+
+    if (which == "decode") {
+        RunDecodeBench(image, options.reps);
+    } else if (which == "format") {
+        RunFormatBench(image, options.reps);
+    } else if (which == "parallel") {
+        RunParallelBench(image, options.reps);
+    } else if (which == "traversal") {
+        RunTraversalBench(image, options.reps);
+    } else if (which == "cfg") {
+        RunCfgBench(image, options.reps);
+    } else if (which == "scan") {
+        RunScanBench(image, options.reps);
+    } else if (which == "inst_file") {
+        RunInstFileBench(image, options.reps);
+    } else if (which == "server") {
+        RunServerBench(image);
+    } else {
+        PrintUsage();
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#include "bench_common.h"
+#include <algorithm>
+#include <thread>
+#include <dis86_instruction_stream.h>
+#include <dis86_parallel.h>
+
+// disassembles the image `reps` times into a buffer that is reused and returns MB/s
+static f64 BenchParallel(const std::vector<u8>& image, u32 reps, u32 numThreads) {
+    OutputBuffer out;
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < reps; i++) {
+        out.Clear();
+        DisassembleParallel(ByteSpan{image.data(), image.size()}, numThreads, out);
+    }
+    return (f64)image.size() * reps / SecondsSince(start) / (1024 * 1024);
+}
+
+void RunParallelBench(const std::vector<u8>& image, u32 reps) {
+    u32 maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    std::cout << "parallel disassembly (" << image.size() << " bytes x " << reps
+              << ", " << maxThreads << " hardware threads)\n";
+    f64 single = 0;
+    for (u32 numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        f64 mbPerSec = BenchParallel(image, reps, numThreads);
+        if (numThreads == 1) {
+            single = mbPerSec;
+        }
+        std::cout << "  " << numThreads << " threads: " << mbPerSec << " MB/s ("
+                  << mbPerSec / single << "x)\n";
+    }
+    std::cout << std::flush;
+}
@@ -0,0 +1,35 @@
+#include "bench_common.h"
+#include <dis86_scan.h>
+
+void RunScanBench(const std::vector<u8>& image, u32 reps) {
+    ByteSpan bytes = {image.data(), image.size()};
+    // a bp frame prologue and a call, both common in real code
+    std::vector<std::vector<u8>> patterns = { { 0x55, 0x8b, 0xec }, { 0xe8 } };
+    f64 gb = (f64)image.size() * reps / 1e9;
+
+    // the full decode the scan stands in for
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < reps; i++) {
+        InstStream instStream(bytes);
+        while (instStream.NextInstruction()) {}
+    }
+    std::cout << "scan (" << image.size() << " bytes x " << reps << ")\n"
+              << "  decode: " << gb / SecondsSince(start) << " GB/s\n";
+
+    ScanResult result;
+    for (ScanIsa isa : { ScanIsa::SCALAR, ScanIsa::SSSE3, ScanIsa::AVX2 }) {
+        if (!IsScanIsaSupported(isa)) {
+            continue;
+        }
+        ScanImage(bytes, patterns, result, isa);
+        start = std::chrono::steady_clock::now();
+        for (u32 i = 0; i < reps; i++) {
+            ScanImage(bytes, patterns, result, isa);
+        }
+        std::cout << "  scan " << GetScanIsaName(isa) << ": " << gb / SecondsSince(start)
+                  << " GB/s\n";
+    }
+    std::cout << "  " << result.numValidStarts << " valid starts, " << result.matches[0].size()
+              << " prologues, " << result.matches[1].size() << " calls\n"
+              << std::flush;
+}
@@ -0,0 +1,95 @@
+#include "bench_common.h"
+#include <algorithm>
+#include <thread>
+#include <dis86_server.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+
+// bytes per request, about a small .COM file
+#define REQUEST_SIZE (4 * 1024)
+#define REQUESTS_PER_CLIENT 1000
+
+// numClients connections send requests back to back, returns every
+// request's latency in microseconds
+static std::vector<f64> LoadTest(const std::string& socketPath, const std::vector<u8>& image,
+                                 u32 numClients, f64& seconds) {
+    std::vector<std::vector<f64>> latencies(numClients);
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < numClients; i++) {
+        clients.emplace_back([&, i]() {
+            Client client;
+            if (!client.Connect(socketPath.c_str())) {
+                std::cerr << "could not connect to the server" << std::endl;
+                std::exit(1);
+            }
+            std::string text;
+            ServerStatus status;
+            u64 numSlices = image.size() / REQUEST_SIZE;
+            for (u32 r = 0; r < REQUESTS_PER_CLIENT; r++) {
+                // slices are cut at arbitrary bytes, so a request may end in
+                // the middle of an instruction, like a truncated file
+                u64 slice = (i * REQUESTS_PER_CLIENT + r) % numSlices;
+                ByteSpan code = {image.data() + slice * REQUEST_SIZE, REQUEST_SIZE};
+                auto sent = std::chrono::steady_clock::now();
+                if (!client.Disassemble(code, status, text)) {
+                    std::cerr << "lost the connection to the server" << std::endl;
+                    std::exit(1);
+                }
+                latencies[i].push_back(SecondsSince(sent) * 1e6);
+            }
+        });
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    seconds = SecondsSince(start);
+
+    std::vector<f64> all;
+    for (const std::vector<f64>& clientLatencies : latencies) {
+        all.insert(all.end(), clientLatencies.begin(), clientLatencies.end());
+    }
+    std::sort(all.begin(), all.end());
+    return all;
+}
+
+void RunServerBench(const std::vector<u8>& image) {
+    if (image.size() < REQUEST_SIZE) {
+        std::cerr << "image smaller than one request" << std::endl;
+        return;
+    }
+    u32 numWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+    std::string socketPath = "/tmp/dis86_bench_" + std::to_string(getpid()) + ".sock";
+    ServerOptions options;
+    options.socketPath = socketPath.c_str();
+    options.numWorkers = numWorkers;
+    Server server(options, DisassembleText);
+    if (!server.Start()) {
+        return;
+    }
+    std::thread serverThread(&Server::Run, &server);
+
+    std::cout << "server load test (" << REQUEST_SIZE << " byte requests, " << REQUESTS_PER_CLIENT
+              << " per client, " << numWorkers << " workers)\n";
+    for (u32 numClients : { 1u, numWorkers, numWorkers * 4 }) {
+        f64 seconds;
+        std::vector<f64> latencies = LoadTest(socketPath, image, numClients, seconds);
+        auto percentile = [&](f64 p) { return latencies[(u64)(p * (latencies.size() - 1))]; };
+        std::cout << "  " << numClients << " clients: " << (u64)(latencies.size() / seconds)
+                  << " req/s, p50 " << percentile(0.5) << " us, p99 " << percentile(0.99)
+                  << " us, max " << latencies.back() << " us\n";
+    }
+    std::cout << std::flush;
+
+    server.Stop();
+    serverThread.join();
+}
+
+#else
+
+void RunServerBench(const std::vector<u8>&) {
+    std::cerr << "the server needs unix domain sockets" << std::endl;
+}
+
+#endif
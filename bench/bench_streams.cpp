@@ -0,0 +1,207 @@
+#include "bench_common.h"
+#include <cstring>
+#include <random>
+#include <sstream>
+
+// the supported reg field values of the immediate ALU group (add, adc, sbb,
+// sub, cmp) and the shift group (everything but the undocumented 110)
+static const u8 ALU_IMM_OPS[] = { 0, 2, 3, 5, 7 };
+static const u8 SHIFT_OPS[] = { 0, 1, 2, 3, 4, 5, 7 };
+// first bytes of the reg <-> reg/mem forms of mov, add, adc, sbb, sub, cmp
+static const u8 RM2REG_OPS[] = { 0x88, 0x00, 0x10, 0x18, 0x28, 0x38 };
+// first bytes of the immediate to accumulator forms of add, adc, sbb, sub, cmp
+static const u8 IMM_ACC_OPS[] = { 0x04, 0x14, 0x1c, 0x2c, 0x3c };
+static const u8 ONE_BYTE_OPS[] = {
+    0x50, 0x53, 0x55, 0x56, 0x58, 0x5b, 0x5d, 0x5e, // push/pop reg
+    0x40, 0x43, 0x48, 0x4b,                         // inc/dec reg
+    0x91, 0x93,                                     // xchg ax, reg
+    0x06, 0x1e, 0x07, 0x1f,                         // push/pop sreg
+    0x98, 0x99, 0x9c, 0x9d, 0x9e, 0x9f, 0xd7,       // cbw cwd pushf popf sahf lahf xlat
+    0x27, 0x2f, 0x37, 0x3f,                         // daa das aaa aas
+};
+
+const InstMix INST_MIXES[] = {
+    //               mov alu shift one mem branch
+    { "mov",      {{ 8,  1,  0,    1,  0,  0 }} },
+    { "alu_imm",  {{ 1,  8,  0,    1,  0,  0 }} },
+    { "shift",    {{ 1,  1,  8,    0,  0,  0 }} },
+    { "one_byte", {{ 1,  0,  0,    9,  0,  0 }} },
+    { "memory",   {{ 1,  1,  0,    0,  8,  0 }} },
+    { "branch",   {{ 2,  2,  0,    1,  0,  5 }} },
+    { "mixed",    {{ 3,  2,  1,    2,  2,  2 }} },
+};
+const u32 NUM_INST_MIXES = ARR_SIZE(INST_MIXES);
+
+static const char *INST_CLASS_NAMES[(u32)InstClass::NUM] = {
+    "mov", "alu_imm", "shift", "one_byte", "memory", "branch",
+};
+
+class StreamGenerator {
+public:
+    StreamGenerator(u32 seed) : rng(seed) {}
+
+    u32 Next(u32 bound) {
+        return rng() % bound;
+    }
+
+    void Imm(bool isWide) {
+        bytes.push_back((u8)rng());
+        if (isWide) {
+            bytes.push_back((u8)rng());
+        }
+    }
+
+    // mod r/m byte plus the displacement it asks for, mod is chosen at random
+    // unless memoryOnly, which covers the four addressing forms evenly
+    void ModRM(u8 regField, bool memoryOnly) {
+        u8 rm = Next(8);
+        u8 mod;
+        u32 form = Next(4);
+        if (memoryOnly) {
+            // no displacement, direct address, 8 bit and 16 bit displacement
+            mod = (form <= 1) ? 0b00 : (form == 2) ? 0b01 : 0b10;
+            if (form == 0 && rm == 0b110) {
+                rm = 0b100;
+            } else if (form == 1) {
+                rm = 0b110;
+            }
+        } else {
+            mod = (u8)form;
+        }
+        bytes.push_back((mod << 6) | (regField << 3) | rm);
+
+        bool direct = (mod == 0b00 && rm == 0b110);
+        if (mod == 0b01) {
+            Imm(false);
+        } else if (mod == 0b10 || direct) {
+            Imm(true);
+        }
+    }
+
+    void Emit(InstClass instClass) {
+        switch (instClass) {
+            case InstClass::MOV: {
+                u32 form = Next(4);
+                if (form <= 1) {
+                    bytes.push_back(0x88 | Next(4));
+                    ModRM(Next(8), false);
+                } else if (form == 2) {
+                    u8 op = 0xb0 | Next(16);
+                    bytes.push_back(op);
+                    Imm(op & 0b1000);
+                } else {
+                    u8 op = 0xc6 | Next(2);
+                    bytes.push_back(op);
+                    ModRM(0, false);
+                    Imm(op & 1);
+                }
+                break;
+            }
+            case InstClass::ALU_IMM: {
+                if (Next(4) == 0) {
+                    u8 op = IMM_ACC_OPS[Next(ARR_SIZE(IMM_ACC_OPS))] | Next(2);
+                    bytes.push_back(op);
+                    Imm(op & 1);
+                } else {
+                    static const u8 ops[] = { 0x80, 0x81, 0x83 };
+                    u8 op = ops[Next(3)];
+                    bytes.push_back(op);
+                    ModRM(ALU_IMM_OPS[Next(ARR_SIZE(ALU_IMM_OPS))], false);
+                    Imm(op == 0x81);
+                }
+                break;
+            }
+            case InstClass::SHIFT: {
+                bytes.push_back(0xd0 | Next(4));
+                ModRM(SHIFT_OPS[Next(ARR_SIZE(SHIFT_OPS))], false);
+                break;
+            }
+            case InstClass::ONE_BYTE: {
+                bytes.push_back(ONE_BYTE_OPS[Next(ARR_SIZE(ONE_BYTE_OPS))]);
+                break;
+            }
+            case InstClass::MEMORY: {
+                bytes.push_back(RM2REG_OPS[Next(ARR_SIZE(RM2REG_OPS))] | Next(4));
+                ModRM(Next(8), true);
+                break;
+            }
+            case InstClass::BRANCH: {
+                // short displacements so most targets land inside the stream
+                u32 form = Next(8);
+                if (form <= 3) {
+                    bytes.push_back(0x70 | Next(16));
+                    Imm(false);
+                } else if (form == 4) {
+                    bytes.push_back(0xe0 | Next(4));
+                    Imm(false);
+                } else if (form == 5) {
+                    bytes.push_back(0xeb);
+                    Imm(false);
+                } else if (form == 6) {
+                    bytes.push_back(0xe8);
+                    bytes.push_back((u8)rng());
+                    bytes.push_back(Next(2) ? 0x00 : 0xff);
+                } else {
+                    bytes.push_back(0xc3);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    std::vector<u8> bytes;
+
+private:
+    std::mt19937 rng;
+};
+
+std::vector<u8> GenerateStream(const InstMix& mix, u64 size, u32 seed) {
+    u32 totalWeight = 0;
+    for (u32 weight : mix.weights) {
+        totalWeight += weight;
+    }
+
+    StreamGenerator generator(seed);
+    generator.bytes.reserve(size + MAX_INST_BYTES);
+    while (totalWeight && generator.bytes.size() < size) {
+        u32 pick = generator.Next(totalWeight);
+        u32 instClass = 0;
+        while (pick >= mix.weights[instClass]) {
+            pick -= mix.weights[instClass++];
+        }
+        generator.Emit((InstClass)instClass);
+    }
+    return generator.bytes;
+}
+
+bool ParseInstMix(const std::string& str, InstMix& mix) {
+    for (u32 i = 0; i < NUM_INST_MIXES; i++) {
+        if (str == INST_MIXES[i].name) {
+            mix = INST_MIXES[i];
+            return true;
+        }
+    }
+
+    // custom mixes are written as class=weight,class=weight...
+    mix = { "custom", {} };
+    std::stringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            return false;
+        }
+        std::string name = item.substr(0, eq);
+        u32 instClass = 0;
+        while (instClass < (u32)InstClass::NUM && name != INST_CLASS_NAMES[instClass]) {
+            instClass++;
+        }
+        if (instClass == (u32)InstClass::NUM) {
+            return false;
+        }
+        mix.weights[instClass] = std::stoul(item.substr(eq + 1));
+    }
+    return true;
+}
@@ -0,0 +1,123 @@
+#include "bench_common.h"
+#include <cstdio>
+#include <filesystem>
+#include <dis86_instruction_stream.h>
+#include <dis86_labels.h>
+
+// decodes the image and hands each instruction to onInst, returns the
+// number of instructions
+template<typename InstFn>
+static u64 DecodeImage(InstStream& instStream, InstFn onInst) {
+    u64 numInsts = 0;
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        onInst(inst);
+        numInsts++;
+    }
+    if (instStream.Failed()) {
+        std::cerr << "benchmark stream failed to decode" << std::endl;
+        std::exit(1);
+    }
+    return numInsts;
+}
+
+static BenchResult MakeResult(const char *mix, const char *mode, u64 numBytes,
+                              u64 numInsts, f64 seconds) {
+    BenchResult result;
+    result.mix = mix;
+    result.mode = mode;
+    result.numBytes = numBytes;
+    result.numInsts = numInsts;
+    result.seconds = seconds;
+    return result;
+}
+
+std::vector<BenchResult> RunSuite(const InstMix& mix, const BenchOptions& options) {
+    std::vector<u8> image = GenerateStream(mix, options.size, options.seed);
+    ByteSpan span = {image.data(), image.size()};
+    u64 totalBytes = image.size() * options.reps;
+    std::vector<BenchResult> results;
+
+    // decode only
+    u64 numInsts = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < options.reps; i++) {
+        InstStream instStream(span);
+        numInsts += DecodeImage(instStream, [](const Instruction&) {});
+    }
+    results.push_back(MakeResult(mix.name, "decode", totalBytes, numInsts, SecondsSince(start)));
+
+    // decode and format into memory
+    numInsts = 0;
+    OutputBuffer text;
+    start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < options.reps; i++) {
+        InstStream instStream(span);
+        numInsts += DecodeImage(instStream, [&](const Instruction& inst) {
+            inst.Format(text);
+            if (text.Size() > 1024 * 1024) {
+                text.Clear();
+            }
+        });
+    }
+    results.push_back(MakeResult(mix.name, "decode_format", totalBytes, numInsts, SecondsSince(start)));
+
+    // what dis86 does: map the file, decode, format and write to the null device
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+        ("dis86_bench_" + std::string(mix.name) + ".bin");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write((const char *)image.data(), image.size());
+    }
+    numInsts = 0;
+    start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < options.reps; i++) {
+        MappedFileSource mappedFile(path.string().c_str());
+        std::ofstream nullFile(NULL_DEVICE, std::ios::binary);
+        OutputBuffer out(&nullFile);
+        InstStream instStream(&mappedFile);
+        numInsts += DecodeImage(instStream, [&](const Instruction& inst) { inst.Format(out); });
+    }
+    results.push_back(MakeResult(mix.name, "end_to_end", totalBytes, numInsts, SecondsSince(start)));
+    std::filesystem::remove(path);
+
+    // dis86 --labels
+    numInsts = 0;
+    start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < options.reps; i++) {
+        std::ofstream nullFile(NULL_DEVICE, std::ios::binary);
+        OutputBuffer out(&nullFile);
+        InstStream instStream(span);
+        if (!DisassembleWithLabels(instStream, out)) {
+            std::cerr << "benchmark stream failed to decode" << std::endl;
+            std::exit(1);
+        }
+        numInsts += results[0].numInsts / options.reps;
+    }
+    results.push_back(MakeResult(mix.name, "labels", totalBytes, numInsts, SecondsSince(start)));
+
+    return results;
+}
+
+void PrintResults(const std::vector<BenchResult>& results, bool json) {
+    if (json) {
+        std::printf("{\n  \"benchmark\": \"dis86\",\n  \"results\": [\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& r = results[i];
+            std::printf("    {\"mix\": \"%s\", \"mode\": \"%s\", \"bytes\": %llu, "
+                "\"instructions\": %llu, \"seconds\": %.6f, \"mb_per_s\": %.3f, "
+                "\"inst_per_s\": %.0f, \"ns_per_inst\": %.3f}%s\n",
+                r.mix.c_str(), r.mode.c_str(), (unsigned long long)r.numBytes,
+                (unsigned long long)r.numInsts, r.seconds, r.MBPerSec(),
+                r.InstPerSec(), r.NsPerInst(), (i + 1 < results.size()) ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+        return;
+    }
+
+    std::printf("%-10s %-14s %12s %14s %12s\n", "mix", "mode", "MB/s", "inst/s", "ns/inst");
+    for (const BenchResult& r : results) {
+        std::printf("%-10s %-14s %12.2f %14.0f %12.2f\n", r.mix.c_str(), r.mode.c_str(),
+            r.MBPerSec(), r.InstPerSec(), r.NsPerInst());
+    }
+}
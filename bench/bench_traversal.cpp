@@ -0,0 +1,45 @@
+#include "bench_common.h"
+#include <algorithm>
+#include <thread>
+#include <dis86_traversal.h>
+
+// an entry point every this many bytes, like the function starts a symbol
+// table would give, so there is work to share from the start
+#define ENTRY_SPACING 4096
+
+// traverses the image `reps` times and returns instructions per second
+static f64 BenchTraversal(const std::vector<u8>& image, u32 reps, u32 numThreads) {
+    u64 numInsts = 0;
+    f64 seconds = 0;
+    for (u32 i = 0; i < reps; i++) {
+        // the bitmaps are part of the cost, so each rep starts from scratch
+        auto start = std::chrono::steady_clock::now();
+        Traversal traversal(ByteSpan{image.data(), image.size()});
+        for (u64 offset = 0; offset < image.size(); offset += ENTRY_SPACING) {
+            traversal.AddEntryPoint(offset);
+        }
+        traversal.Run(numThreads);
+        seconds += SecondsSince(start);
+        for (const BasicBlock& block : traversal.GetBlocks()) {
+            numInsts += block.numInsts;
+        }
+    }
+    return numInsts / seconds;
+}
+
+void RunTraversalBench(const std::vector<u8>& image, u32 reps) {
+    u32 maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    std::cout << "recursive traversal (" << image.size() << " bytes x " << reps
+              << ", " << maxThreads << " hardware threads)\n";
+    f64 single = 0;
+    for (u32 numThreads = 1; numThreads <= maxThreads; numThreads++) {
+        f64 instPerSec = BenchTraversal(image, reps, numThreads);
+        if (numThreads == 1) {
+            single = instPerSec;
+        }
+        std::cout << "  " << numThreads << " threads: " << instPerSec / 1e6 << " M inst/s ("
+                  << instPerSec / single << "x)\n";
+    }
+    std::cout << std::flush;
+}
@@ -0,0 +1,23 @@
+#pragma once
+// public header of dis86_core, for programs that link the decoder as a
+// library. everything needed to decode and print 8086 code:
+//
+//   InstStream instStream(ByteSpan{code, size});
+//   OutputBuffer out(&std::cout);
+//   Instruction inst;
+//   while (inst = instStream.NextInstruction()) {
+//       inst.Format(out);
+//   }
+//   out.Flush();
+//   if (instStream.Failed()) { ... }
+//
+// Instruction gives the operation and its Operands, and where it was found
+// in the input. the headers here in include/ are the whole public interface,
+// dis86_c.h is the same for C. the ones in src/ are internal to the tools
+// and can change with them.
+#include <dis86_num_types.h>
+#include <dis86_byte_source.h>
+#include <dis86_operand.h>
+#include <dis86_instruction.h>
+#include <dis86_instruction_stream.h>
+#include <dis86_output_buffer.h>
@@ -0,0 +1,72 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <istream>
+#include <memory>
+
+struct ByteSpan {
+    const u8 *data;
+    u64 size;
+};
+
+// where an InstStream gets its bytes from. the stream decodes straight out of
+// the returned blocks, so sources that already hold the whole input (memory,
+// mapped files) hand it over in one block without copying.
+class ByteSource {
+public:
+    virtual ~ByteSource() = default;
+
+    // gets the next block of input. the last `keep` bytes of the previous block
+    // haven't been decoded yet and must be at the start of the new block.
+    // returns false once there is no more input.
+    virtual bool Refill(ByteSpan &block, u32 keep) = 0;
+};
+
+class MemorySource : public ByteSource {
+public:
+    MemorySource(ByteSpan bytes);
+    bool Refill(ByteSpan &block, u32 keep) override;
+    // hands out bytes on the next Refill, as if newly constructed
+    void Reset(ByteSpan bytes);
+
+private:
+    ByteSpan bytes;
+    bool handedOut;
+};
+
+class StreamSource : public ByteSource {
+public:
+    StreamSource(std::istream *input, u32 bufferSize);
+    bool Refill(ByteSpan &block, u32 keep) override;
+
+private:
+    std::istream *input;
+    std::unique_ptr<u8[]> buffer;
+    u32 capacity;
+    u32 size;
+};
+
+// maps a file into memory, several processes decoding the same file share
+// the page cache and decoding can start before the file has been read in
+class MappedFileSource : public ByteSource {
+public:
+    MappedFileSource(const char *path);
+    ~MappedFileSource();
+    MappedFileSource(const MappedFileSource&) = delete;
+    MappedFileSource& operator=(const MappedFileSource&) = delete;
+
+    // false if the file could not be mapped, e.g. it is a pipe
+    bool IsOpen() const;
+    ByteSpan GetBytes() const;
+    bool Refill(ByteSpan &block, u32 keep) override;
+
+private:
+    ByteSpan bytes;
+    bool isOpen;
+    bool handedOut;
+#ifdef _WIN32
+    void *fileHandle;
+    void *mappingHandle;
+#else
+    int fd;
+#endif
+};
@@ -0,0 +1,103 @@
+#ifndef DIS86_C_H
+#define DIS86_C_H
+/* C interface to dis86_core for programs that can't use the C++ classes.
+ * nothing here throws, allocates per call or prints: decoding fills arrays
+ * the caller owns and every function reports what happened in its return
+ * value.
+ *
+ *   dis86_decoder *decoder = dis86_decoder_new();
+ *   dis86_inst insts[256];
+ *   char text[DIS86_MAX_INST_STR_LEN + 1];
+ *   size_t count = dis86_decode(decoder, buf, len, insts, 256);
+ *   for (size_t i = 0; i < count; i++) {
+ *       dis86_format(&insts[i], text, sizeof(text));
+ *   }
+ *   if (dis86_decoder_status(decoder) != DIS86_OK) { ... }
+ *   dis86_decoder_free(decoder);
+ *
+ * the structs below only ever grow into their reserved fields, and
+ * DIS86_ABI_VERSION changes if their layout or any meaning here does. */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DIS86_ABI_VERSION 1
+/* longest text dis86_format writes, not counting the terminating 0 */
+#define DIS86_MAX_INST_STR_LEN 104
+
+/* what the last dis86_decode on a decoder stopped on */
+typedef enum dis86_status {
+    DIS86_OK = 0,        /* decoded all of buf, or filled out_insts */
+    DIS86_INVALID = 1,   /* the bytes after the last instruction aren't an 8086 instruction */
+    DIS86_TRUNCATED = 2, /* buf ends part way through an instruction */
+} dis86_status;
+
+/* dis86_operand.type */
+enum {
+    DIS86_OPERAND_NONE = 0,
+    DIS86_OPERAND_REGISTER = 1,    /* index: al/ax cl/cx dl/dx bl/bx ah/sp ch/bp dh/si bh/di */
+    DIS86_OPERAND_SEG_REG = 2,     /* index: es cs ss ds */
+    DIS86_OPERAND_IMMEDIATE = 3,   /* value */
+    DIS86_OPERAND_MEMORY = 4,      /* index: bx+si bx+di bp+si bp+di si di bp bx direct, value: displacement */
+    DIS86_OPERAND_RELATIVE = 5,    /* value: jump displacement from the end of the instruction */
+    DIS86_OPERAND_FAR_POINTER = 6, /* segment:value */
+};
+
+/* dis86_inst.prefix */
+enum {
+    DIS86_PREFIX_NONE = 0,
+    DIS86_PREFIX_REP = 1,
+    DIS86_PREFIX_REPNE = 2,
+};
+
+typedef struct dis86_operand {
+    uint8_t type;
+    uint8_t index;
+    uint8_t is_wide;
+    uint8_t reserved;
+    uint16_t value;
+    uint16_t segment;
+} dis86_operand;
+
+typedef struct dis86_inst {
+    uint64_t offset; /* from the start of the buf it was decoded from */
+    uint8_t op;      /* operation, dis86_op_name gives its mnemonic */
+    uint8_t length;  /* encoded bytes, including a rep prefix */
+    uint8_t prefix;
+    uint8_t reserved[5];
+    dis86_operand operands[2];
+} dis86_inst;
+
+typedef struct dis86_decoder dis86_decoder;
+
+uint32_t dis86_abi_version(void);
+
+/* NULL if out of memory. a decoder can be reused for any number of
+ * dis86_decode calls but only by one thread at a time. */
+dis86_decoder *dis86_decoder_new(void);
+void dis86_decoder_free(dis86_decoder *decoder);
+
+/* decodes buf from its start into out_insts until all of it is decoded,
+ * cap instructions have been written or the next bytes don't decode, and
+ * returns how many were written. to go on after a full out_insts, call
+ * again from the end of the last instruction. */
+size_t dis86_decode(dis86_decoder *decoder, const uint8_t *buf, size_t len,
+                    dis86_inst *out_insts, size_t cap);
+dis86_status dis86_decoder_status(const dis86_decoder *decoder);
+
+/* writes the nasm text of inst to out, cut short to fit cap bytes and
+ * always 0 terminated if cap > 0. returns the length of the whole text like
+ * snprintf, or 0 if inst isn't something dis86_decode could have written. */
+size_t dis86_format(const dis86_inst *inst, char *out, size_t cap);
+
+/* mnemonic of dis86_inst.op, NULL past the last operation */
+const char *dis86_op_name(uint8_t op);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
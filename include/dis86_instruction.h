@@ -0,0 +1,184 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <string>
+#include <string_view>
+#include <array>
+#include <dis86_operand.h>
+#include <dis86_output_buffer.h>
+
+// longest 8086 instruction: opcode, mod r/m, 2 byte displacement, 2 byte data
+#define MAX_INST_BYTES 6
+// rep prefix, longest mnemonic, "word " size prefixes and both operands
+#define MAX_INST_STR_LEN 104
+// "0000002a  c7 87 e8 03 d2 04  " in front of the text in offset listings,
+// with room for addresses past 4 GiB
+#define MAX_LISTING_PREFIX_LEN 40
+
+enum class OpType : u8 {
+    NONE,
+    ADD,
+    SUB,
+    CMP,
+    MOV,
+    ADC,
+    SBB,
+    PUSH,
+    POP,
+    XCHG,
+    IN,
+    OUT,
+    XLAT,
+    LEA,
+    LDS,
+    LES,
+    LAHF,
+    SAHF,
+    PUSHF,
+    POPF,
+    OR,
+    AND,
+    XOR,
+    INC,
+    AAA,
+    DAA,
+    DEC,
+    NEG,
+    AAS,
+    DAS,
+    MUL,
+    IMUL,
+    AAM,
+    DIV,
+    IDIV,
+    AAD,
+    CBW,
+    CWD,
+    NOT,
+    SHL,
+    SHR,
+    SAR,
+    ROL,
+    ROR,
+    RCL,
+    RCR,
+
+    // conditional jumps, in opcode order (0x70 - 0x7f)
+    JO,
+    JNO,
+    JB,
+    JNB,
+    JE,
+    JNE,
+    JBE,
+    JA,
+    JS,
+    JNS,
+    JP,
+    JNP,
+    JL,
+    JNL,
+    JLE,
+    JG,
+    LOOPNZ,
+    LOOPZ,
+    LOOP,
+    JCXZ,
+    JMP,
+    CALL,
+    // indirect far jmp/call through memory
+    JMP_FAR,
+    CALL_FAR,
+    RET,
+    RETF,
+    INT,
+    INT3,
+    INTO,
+    IRET,
+
+    // string instructions
+    MOVSB,
+    MOVSW,
+    CMPSB,
+    CMPSW,
+    STOSB,
+    STOSW,
+    LODSB,
+    LODSW,
+    SCASB,
+    SCASW,
+    NUM_OPS
+};
+
+// rep prefixes in front of string instructions (f3 and f2). f3 reads as repe
+// in front of cmps/scas and as rep otherwise.
+enum class RepPrefix : u8 {
+    NONE,
+    REP,
+    REPNE,
+};
+
+// how instructions are written out by dis86
+enum class OutputFormat : u8 {
+    TEXT,    // nasm syntax, one instruction per line
+    LISTING, // offset and encoded bytes in front of the text
+    BINARY,  // fixed size records, see dis86_inst_file.h
+};
+
+class Instruction {
+public:
+    void Print();
+
+    // writes the instruction text (without a newline) to out and returns the
+    // end, at most MAX_INST_STR_LEN bytes are written
+    char *Format(char *out) const;
+    // appends the instruction and a newline to out
+    void Format(OutputBuffer& out) const;
+    // writes a jump/call/loop with its target as label_<labelIdx> instead of
+    // an offset from $, see GetBranchTarget
+    char *FormatBranch(char *out, u32 labelIdx) const;
+    // same as Format but the line starts with the offset and the encoded
+    // bytes (GetLength() of them), which the caller still has from decoding
+    void FormatListing(OutputBuffer& out, const u8 *bytes) const;
+    void Format(OutputBuffer& out, OutputFormat format, const u8 *bytes) const;
+
+    explicit operator bool() const;
+
+    Instruction(OpType type, Operand op1, Operand op2);
+
+    Instruction();
+
+    // compares what the instruction does, not where it came from
+    bool operator==(const Instruction& rhs) const; 
+
+    OpType GetOpType() const;
+    const Operand& GetOperand(u32 idx) const;
+    std::string_view GetOpStr() const;
+
+    // where the instruction starts in the decoded input and how many bytes
+    // it was encoded in, set by InstStream as it decodes
+    u64 GetOffset() const;
+    u8 GetLength() const;
+    void SetLocation(u64 offset, u8 length);
+
+    RepPrefix GetPrefix() const;
+    void SetPrefix(RepPrefix prefix);
+
+    // target offset of a relative jmp/jcc/call/loop, false for everything
+    // else. the target can be outside of the decoded input.
+    bool GetBranchTarget(i64& target) const;
+    // jumps, calls, loops and returns, these end a basic block
+    bool IsControlFlow() const;
+    // false if execution never goes on to the next instruction, e.g. jmp/ret
+    bool FallsThrough() const;
+
+private:
+    OpType opType;
+    u8 length;
+    RepPrefix prefix;
+    Operand operands[2];
+    u64 offset;
+
+    static const std::array<std::string_view, (u8)OpType::NUM_OPS> opStrs;
+
+    bool NeedSize(OperandType type) const;
+};
\ No newline at end of file
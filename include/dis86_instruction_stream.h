@@ -0,0 +1,110 @@
+#pragma once
+
+#include <dis86_num_types.h>
+#include <dis86_instruction.h>
+#include <dis86_byte_source.h>
+
+#include <istream>
+#include <memory>
+
+#define DEFAULT_STREAM_BUFFER_SIZE (1024 * 64)
+
+class DecodeCache;
+struct InstructionFormat;
+
+// how much work decoding took, to check the decoders stay on their fast path
+struct DecodeCounters {
+    u64 numInsts;    // instructions returned, including decode cache hits
+    u64 numProbes;   // formats whose literal bits were compared with the input
+    u64 numAttempts; // formats whose fields were read, one per instruction
+                     // unless the input doesn't decode
+};
+
+class InstStream {
+public:
+    // returns a falsy Instruction at the end of the input or when the next
+    // bytes don't decode, in which case Failed() is true and the stream stops
+    Instruction NextInstruction();
+    // runtime interpreter trying every format in order, kept as a reference
+    // for the compile-time decoders
+    Instruction NextInstructionLinear();
+    // bytes are read from binFile in blocks of bufferSize as decoding goes
+    // on, so memory use does not depend on the size of the input
+    InstStream(std::istream *binFile, u32 bufferSize = DEFAULT_STREAM_BUFFER_SIZE);
+    // decodes straight out of bytes, which must outlive the stream. offsets
+    // are reported from startOffset, for bytes cut out of a larger image
+    InstStream(ByteSpan bytes, u64 startOffset = 0);
+    // source must outlive the stream
+    InstStream(ByteSource *source);
+
+    // starts over on bytes, only for streams made from a ByteSpan. lets one
+    // stream hop around an image without allocating.
+    void Restart(ByteSpan bytes, u64 startOffset = 0);
+
+    // looks instructions up in cache before decoding them and adds the ones
+    // it had to decode. the cache must outlive the stream, null turns it off.
+    void SetDecodeCache(DecodeCache *cache);
+
+    bool Failed() const;
+    // counted since the stream was made or the counters were last reset,
+    // Restart keeps them
+    const DecodeCounters& GetDecodeCounters() const;
+    void ResetDecodeCounters();
+    // offset in the input of the next instruction to decode
+    u64 GetOffset() const;
+    // encoded bytes of the instruction last returned, only valid until the
+    // next call to NextInstruction
+    const u8 *GetInstBytes() const;
+
+private:
+    // the format tables and the decoders built from them, see dis86_inst_format.h
+    friend class InstFormats;
+
+    std::unique_ptr<ByteSource> ownedSource;
+    ByteSource *source;
+    // set when decoding out of a ByteSpan, see Restart
+    MemorySource *memorySource;
+    DecodeCache *decodeCache;
+    bool inputEnded;
+    bool failed;
+    DecodeCounters counters;
+    u64 offset;
+    u8 lastInstLength;
+
+    // decoding reads straight through these, bounds are checked once per
+    // instruction by making sure MAX_INST_BYTES can be read from
+    // currentInstPointer and that the instruction didn't end past blockEnd
+    const u8 *blockEnd;
+    const u8 *currentInstPointer;
+    const u8 *readPointer;
+
+    // zero padded copy of the last few bytes of input, used once fewer than
+    // MAX_INST_BYTES remain
+    u8 tail[MAX_INST_BYTES * 2];
+
+    void Refill();
+    bool PrepareInstruction();
+    // steps over a rep prefix in front of a string instruction
+    RepPrefix ReadPrefix();
+    // moves past the decoded instruction and records where it was
+    void CommitInstruction(Instruction& inst, RepPrefix prefix);
+    // keep the decode counters and, when stats are counted, the thread's
+    // stats from one place each. formatIdx is NO_FORMAT for a cache hit.
+    void CountProbe(u32 formatIdx);
+    void CountInstruction(u32 formatIdx, u64 startTicks, u64 decodeTicks);
+    // rewinds to the start of the instruction and stops the stream
+    void FailInstruction(RepPrefix prefix);
+
+    // the decoder generated for the format at FormatIdx
+    template<u32 FormatIdx>
+    Instruction DecodeFormat();
+
+    static inline Operand GetRegOperand(u8 regVal, u8 widthVal);
+    static inline Operand GetSegRegOperand(u8 regVal);
+
+    u16 ParseData(bool isWide, bool isSignExt);
+
+    Instruction TryDecode(const InstructionFormat& format);
+    // bitFieldValues is indexed by BitsUsage, Disp and Data are filled in
+    Instruction BuildInstruction(OpType op, u32 bitFieldFlags, u32 *bitFieldValues);
+};
@@ -0,0 +1,147 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <iostream>
+#include <string_view>
+
+// "word [bx + si - 32768]" plus some slack
+#define MAX_OPERAND_STR_LEN 32
+
+// writes val in decimal and returns the end, two digits at a time out of a
+// table of "00" to "99"
+char *FormatInt(char *out, i32 val);
+// writes an offset in the input as 8 hex digits (16 past 4 GiB)
+char *FormatOffset(char *out, u64 offset);
+
+enum class RegisterIdx : u8 {
+    AL_AX,
+    CL_CX,
+    DL_DX,
+    BL_BX,
+    AH_SP,
+    CH_BP,
+    DH_SI,
+    BH_DI,
+};
+
+enum class SegmentRegIdx : u8 {
+    ES,
+    CS,
+    SS,
+    DS,
+};
+
+enum class AddressExpIdx : u8 {
+    BX_SI,
+    BX_DI,
+    BP_SI,
+    BP_DI,
+    SI,
+    DI,
+    BP,
+    BX,
+    DIRECT,
+};
+
+struct Register {
+    union {
+        RegisterIdx regIdx;
+        SegmentRegIdx sRegIdx;
+    };
+    b8 isWide;
+};
+
+struct EffectiveAddressExp {
+    AddressExpIdx expIdx;
+    u8 isWide;
+    i16 disp;
+};
+
+struct Immediate {
+    union {
+        u16 immU16;
+        i16 immI16;
+    };
+    u8 isWide;
+};
+
+// segment:offset of a direct far jmp/call
+struct FarPointer {
+    u16 offset;
+    u16 segment;
+};
+
+enum class OperandType: u8 {
+    NONE,
+    REGISTER,
+    SEG_REG,
+    IMMEDIATE,
+    MEMORY,
+    // jump displacement from the end of the instruction, stored in immediate
+    RELATIVE,
+    FAR_POINTER,
+};
+
+class Operand {
+public:
+    OperandType operandType;
+    union {
+        EffectiveAddressExp address;
+        Register reg;
+        Immediate immediate;
+        FarPointer farPointer;
+    };
+
+    bool operator==(const Operand& rhs) const;
+    friend std::ostream& operator<<(std::ostream s, const Operand& op);
+    std::string GetStr() const;
+
+    // writes the operand text to out without allocating and returns the end,
+    // at most MAX_OPERAND_STR_LEN bytes are written
+    char *Format(char *out) const;
+
+    // flattened view of the operand used by the compact instruction layouts:
+    // index is the register/segment register/address expression index,
+    // value is the displacement or immediate (the offset of far pointers,
+    // which keep their segment in the other operand's value)
+    u8 GetIndex() const;
+    bool IsWide() const;
+    u16 GetValue() const;
+    static Operand Make(OperandType type, u8 index, bool isWide, u16 value);
+    static Operand MakeFarPointer(u16 segment, u16 offset);
+    // Make (MakeFarPointer with segment for a far pointer) for operands read
+    // from outside the decoder. false if type or index is out of range, the
+    // index is looked up in the formatter's tables.
+    static bool TryMake(OperandType type, u8 index, bool isWide, u16 value, u16 segment,
+                        Operand& out);
+
+private:
+    char *FormatMemory(char *out) const;
+
+    // formatting copies these straight into the output, nothing is built
+    // per operand
+    static constexpr std::string_view registers[8][2] = {
+        {"al", "ax"}, // 000
+        {"cl", "cx"}, // 001
+        {"dl", "dx"}, // 010
+        {"bl", "bx"}, // 011
+        {"ah", "sp"}, // 100
+        {"ch", "bp"}, // 101
+        {"dh", "si"}, // 110
+        {"bh", "di"}, // 111
+    };
+    static constexpr std::string_view segRegisters[4] = {
+        "es", "cs", "ss", "ds",
+    };
+    // opening bracket and address expression of memory operands
+    static constexpr std::string_view addressExps[9] = {
+        "[bx + si",
+        "[bx + di",
+        "[bp + si",
+        "[bp + di",
+        "[si",
+        "[di",
+        "[bp",
+        "[bx",
+        "[", // direct address (no expression)
+    };
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <memory>
+#include <ostream>
+
+#define DEFAULT_OUTPUT_BUFFER_SIZE (1024 * 64)
+
+// collects formatted text in one block. with a sink the block is written out
+// in one go whenever it fills up (and on Flush/destruction), without one the
+// block grows and the text is read back with Data/Size.
+class OutputBuffer {
+public:
+    OutputBuffer();
+    explicit OutputBuffer(std::ostream *sink, u32 capacity = DEFAULT_OUTPUT_BUFFER_SIZE);
+    // block is caller owned and has to outlive the buffer
+    OutputBuffer(char *block, u32 capacity, std::ostream *sink);
+    ~OutputBuffer();
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    // returns room for at least numBytes, Commit the end of what was written
+    inline char *Reserve(u64 numBytes) {
+        if (size + numBytes > capacity) {
+            MakeRoom(numBytes);
+        }
+        return block + size;
+    }
+    inline void Commit(char *end) {
+        size = end - block;
+    }
+
+    void Write(const char *str, u64 len);
+    void Flush();
+    void Clear();
+
+    const char *Data() const;
+    u64 Size() const;
+
+private:
+    std::unique_ptr<char[]> ownedBlock;
+    char *block;
+    u64 capacity;
+    u64 size;
+    std::ostream *sink;
+
+    void MakeRoom(u64 numBytes);
+};
@@ -0,0 +1,8 @@
+#pragma once
+#include <dis86_num_types.h>
+
+struct BasicBlock {
+    u64 start; // offset of the first instruction
+    u64 end;   // offset just past the last instruction
+    u32 numInsts;
+};
@@ -0,0 +1,171 @@
+#include <dis86_batch.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// writes finished files to the output in input order. a file finished ahead
+// of its turn is held as a string until the ones before it are written.
+class OrderedWriter {
+public:
+    OrderedWriter(std::ostream& out, u64 numFiles)
+        : out(out), nextFile(0), held(numFiles), isHeld(numFiles, false) {}
+
+    void Write(u64 fileIdx, const OutputBuffer& text) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fileIdx != nextFile) {
+            held[fileIdx].assign(text.Data(), text.Size());
+            isHeld[fileIdx] = true;
+            return;
+        }
+        out.write(text.Data(), text.Size());
+        nextFile++;
+        while (nextFile < held.size() && isHeld[nextFile]) {
+            out.write(held[nextFile].data(), held[nextFile].size());
+            std::string().swap(held[nextFile]);
+            nextFile++;
+        }
+    }
+
+private:
+    std::ostream& out;
+    std::mutex mutex;
+    u64 nextFile;
+    std::vector<std::string> held;
+    std::vector<bool> isHeld;
+};
+
+bool DisassembleText(ByteSpan, InstStream& instStream, OutputBuffer& out) {
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        inst.Format(out);
+    }
+    return !instStream.Failed();
+}
+
+bool ReadWholeFile(const std::string& path, std::vector<u8>& bytes) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    std::streamoff size = file.tellg();
+    if (size < 0) {
+        return false;
+    }
+    bytes.resize(size);
+    file.seekg(0);
+    return (bool)file.read((char *)bytes.data(), size);
+}
+
+static void WriteHeader(OutputBuffer& text, const std::string& path) {
+    text.Write("; file ", 7);
+    text.Write(path.data(), path.size());
+    text.Write("\n", 1);
+}
+
+// output file name of each input: its file name, with the input index in
+// front where inputs from different directories share a name
+static std::vector<std::string> GetOutputNames(const std::vector<std::string>& paths) {
+    std::vector<std::string> names(paths.size());
+    for (u64 i = 0; i < paths.size(); i++) {
+        names[i] = std::filesystem::path(paths[i]).filename().string();
+    }
+    // again until they're unique, a prefixed name can match another input's
+    while (true) {
+        std::unordered_map<std::string, u32> counts;
+        for (const std::string& name : names) {
+            counts[name]++;
+        }
+        bool isUnique = true;
+        for (u64 i = 0; i < names.size(); i++) {
+            if (counts[names[i]] > 1) {
+                names[i] = std::to_string(i) + "_" + names[i];
+                isUnique = false;
+            }
+        }
+        if (isUnique) {
+            return names;
+        }
+    }
+}
+
+BatchStats DisassembleBatch(const std::vector<std::string>& paths, const BatchOptions& options,
+                            std::ostream& out, const BatchFileFn& fileFn) {
+    u32 numThreads = (u32)std::max<u64>(std::min<u64>(options.numThreads, paths.size()), 1);
+    std::atomic<u64> nextFile(0);
+    std::atomic<u64> numFailed(0);
+    std::atomic<u64> numBytes(0);
+    OrderedWriter writer(out, paths.size());
+    std::mutex errorMutex;
+    std::vector<std::string> outNames;
+    if (options.outDir) {
+        outNames = GetOutputNames(paths);
+    }
+
+    auto worker = [&]() {
+        InstStream instStream(ByteSpan{nullptr, 0});
+        OutputBuffer text;
+        std::vector<u8> bytes;
+        u64 fileIdx;
+        while ((fileIdx = nextFile.fetch_add(1)) < paths.size()) {
+            const std::string& path = paths[fileIdx];
+            text.Clear();
+            if (!options.outDir) {
+                WriteHeader(text, path);
+            }
+
+            const char *error = nullptr;
+            if (ReadWholeFile(path, bytes)) {
+                ByteSpan image = {bytes.data(), bytes.size()};
+                instStream.Restart(image);
+                if (!fileFn(image, instStream, text)) {
+                    error = "failed to decode instruction in ";
+                }
+                numBytes += bytes.size();
+            } else {
+                error = "could not open ";
+            }
+
+            if (options.outDir) {
+                std::filesystem::path outPath =
+                    std::filesystem::path(options.outDir) / outNames[fileIdx];
+                outPath += options.outExt;
+                std::ofstream outFile(outPath, std::ios::binary);
+                if (!outFile.write(text.Data(), text.Size())) {
+                    error = "could not write output for ";
+                }
+            } else {
+                writer.Write(fileIdx, text);
+            }
+            if (error) {
+                numFailed++;
+                std::lock_guard<std::mutex> lock(errorMutex);
+                std::cerr << error << path << std::endl;
+            }
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (u32 i = 1; i < numThreads; i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    out.flush();
+    std::chrono::duration<f64> elapsed = std::chrono::steady_clock::now() - start;
+
+    BatchStats stats;
+    stats.numFiles = paths.size();
+    stats.numFailed = numFailed;
+    stats.numBytes = numBytes;
+    stats.seconds = elapsed.count();
+    return stats;
+}
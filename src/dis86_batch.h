@@ -0,0 +1,43 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <dis86_instruction_stream.h>
+#include <dis86_output_buffer.h>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// disassembles one input into out. instStream has already been restarted on
+// image. returns false if decoding stopped on an invalid instruction.
+typedef std::function<bool(ByteSpan image, InstStream& instStream, OutputBuffer& out)> BatchFileFn;
+
+// a BatchFileFn writing plain dis86 output
+bool DisassembleText(ByteSpan image, InstStream& instStream, OutputBuffer& out);
+
+// reads all of path into bytes, reusing its allocation
+bool ReadWholeFile(const std::string& path, std::vector<u8>& bytes);
+
+struct BatchOptions {
+    u32 numThreads = 1;
+    // one output file per input, outDir/<file name><outExt>. inputs whose
+    // file names clash get outDir/<input index>_<file name><outExt>. without
+    // it the outputs are concatenated in input order, each after a
+    // "; file <path>" line
+    const char *outDir = nullptr;
+    const char *outExt = ".asm";
+};
+
+struct BatchStats {
+    u64 numFiles = 0;
+    // couldn't be read, or decoding stopped on an invalid instruction
+    u64 numFailed = 0;
+    u64 numBytes = 0;
+    f64 seconds = 0;
+};
+
+// runs fileFn over every path on a fixed pool of numThreads threads, each
+// with its own InstStream, read buffer and output buffer which are reused
+// from one file to the next. meant for many small inputs, where starting a
+// process per file would cost more than disassembling it.
+BatchStats DisassembleBatch(const std::vector<std::string>& paths, const BatchOptions& options,
+                            std::ostream& out, const BatchFileFn& fileFn);
@@ -0,0 +1,67 @@
+#include <dis86_bitmap.h>
+#include <cassert>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static inline u32 CountTrailingZeros(u64 word) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward64(&idx, word);
+    return idx;
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+// bits [start, end) of the word holding bit start, end is clamped to the word
+static inline u64 WordMask(u64 start, u64 end) {
+    u64 wordEnd = (start / 64 + 1) * 64;
+    u64 numBits = ((end < wordEnd) ? end : wordEnd) - start;
+    u64 mask = (numBits == 64) ? ~(u64)0 : (((u64)1 << numBits) - 1);
+    return mask << (start % 64);
+}
+
+Bitmap::Bitmap(u64 numBits)
+    : words(new std::atomic<u64>[(numBits + 63) / 64]), numWords((numBits + 63) / 64),
+      numBits(numBits) {
+    for (u64 i = 0; i < numWords; i++) {
+        words[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+bool Bitmap::TestRange(u64 start, u64 end) const {
+    assert(end <= numBits);
+    while (start < end) {
+        u64 mask = WordMask(start, end);
+        if (words[start / 64].load(std::memory_order_relaxed) & mask) {
+            return true;
+        }
+        start = (start / 64 + 1) * 64;
+    }
+    return false;
+}
+
+void Bitmap::SetRange(u64 start, u64 end) {
+    assert(end <= numBits);
+    while (start < end) {
+        words[start / 64].fetch_or(WordMask(start, end), std::memory_order_relaxed);
+        start = (start / 64 + 1) * 64;
+    }
+}
+
+u64 Bitmap::FindNext(u64 idx) const {
+    if (idx >= numBits) {
+        return numBits;
+    }
+    u64 wordIdx = idx / 64;
+    u64 word = words[wordIdx].load(std::memory_order_relaxed) & (~(u64)0 << (idx % 64));
+    while (word == 0) {
+        if (++wordIdx == numWords) {
+            return numBits;
+        }
+        word = words[wordIdx].load(std::memory_order_relaxed);
+    }
+    u64 found = wordIdx * 64 + CountTrailingZeros(word);
+    return found < numBits ? found : numBits;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <atomic>
+#include <memory>
+
+// one bit per byte of an image. bits can be set from several threads at
+// once, TestAndSet tells exactly one of them that it set the bit.
+class Bitmap {
+public:
+    Bitmap() : numBits(0) {}
+    explicit Bitmap(u64 numBits);
+
+    inline bool Test(u64 idx) const {
+        return (words[idx / 64].load(std::memory_order_relaxed) >> (idx % 64)) & 1;
+    }
+    inline void Set(u64 idx) {
+        words[idx / 64].fetch_or((u64)1 << (idx % 64), std::memory_order_relaxed);
+    }
+    // sets the bit and returns whether it was already set
+    inline bool TestAndSet(u64 idx) {
+        u64 bit = (u64)1 << (idx % 64);
+        return words[idx / 64].fetch_or(bit, std::memory_order_relaxed) & bit;
+    }
+    // true if any bit in [start, end) is set
+    bool TestRange(u64 start, u64 end) const;
+    void SetRange(u64 start, u64 end);
+    // first set bit at or after idx, Size() if there is none
+    u64 FindNext(u64 idx) const;
+    u64 Size() const { return numBits; }
+
+private:
+    std::unique_ptr<std::atomic<u64>[]> words;
+    u64 numWords;
+    u64 numBits;
+};
@@ -0,0 +1,154 @@
+#include <dis86_byte_source.h>
+#include <dis86_instruction_stream.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MemorySource::MemorySource(ByteSpan bytes) : bytes(bytes), handedOut(false) {}
+
+bool MemorySource::Refill(ByteSpan &block, u32 keep) {
+    (void)keep;
+    if (handedOut || bytes.size == 0) {
+        return false;
+    }
+    handedOut = true;
+    block = bytes;
+    return true;
+}
+
+void MemorySource::Reset(ByteSpan bytes) {
+    this->bytes = bytes;
+    handedOut = false;
+}
+
+StreamSource::StreamSource(std::istream *input, u32 bufferSize) : input(input) {
+    // room for a kept partial instruction plus at least one whole instruction
+    capacity = std::max<u32>(bufferSize, MAX_INST_BYTES * 2);
+    buffer.reset(new u8[capacity]);
+    size = 0;
+}
+
+bool StreamSource::Refill(ByteSpan &block, u32 keep) {
+    assert(keep <= size && keep < MAX_INST_BYTES);
+    std::memmove(buffer.get(), buffer.get() + size - keep, keep);
+    size = keep;
+
+    if (*input) {
+        input->read((char *)buffer.get() + size, capacity - size);
+        size += (u32)input->gcount();
+    }
+    if (size == keep) {
+        return false;
+    }
+
+    block = {buffer.get(), size};
+    return true;
+}
+
+#ifdef _WIN32
+
+MappedFileSource::MappedFileSource(const char *path)
+    : bytes{nullptr, 0}, isOpen(false), handedOut(false),
+      fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr) {
+    fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE || GetFileType(fileHandle) != FILE_TYPE_DISK) {
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize)) {
+        return;
+    }
+    if (fileSize.QuadPart == 0) {
+        // empty files can't be mapped but there is nothing to read anyway
+        isOpen = true;
+        return;
+    }
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle) {
+        return;
+    }
+    void *view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        return;
+    }
+    bytes = {(const u8 *)view, (u64)fileSize.QuadPart};
+    isOpen = true;
+}
+
+MappedFileSource::~MappedFileSource() {
+    if (bytes.data) {
+        UnmapViewOfFile(bytes.data);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+    }
+}
+
+#else
+
+MappedFileSource::MappedFileSource(const char *path)
+    : bytes{nullptr, 0}, isOpen(false), handedOut(false), fd(-1) {
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+        return;
+    }
+    if (fileStat.st_size == 0) {
+        // empty files can't be mapped but there is nothing to read anyway
+        isOpen = true;
+        return;
+    }
+    void *mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        return;
+    }
+    madvise(mapping, fileStat.st_size, MADV_SEQUENTIAL);
+    bytes = {(const u8 *)mapping, (u64)fileStat.st_size};
+    isOpen = true;
+}
+
+MappedFileSource::~MappedFileSource() {
+    if (bytes.data) {
+        munmap((void *)bytes.data, bytes.size);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+#endif
+
+bool MappedFileSource::IsOpen() const {
+    return isOpen;
+}
+
+ByteSpan MappedFileSource::GetBytes() const {
+    return bytes;
+}
+
+bool MappedFileSource::Refill(ByteSpan &block, u32 keep) {
+    (void)keep;
+    if (handedOut || bytes.size == 0) {
+        return false;
+    }
+    handedOut = true;
+    block = bytes;
+    return true;
+}
@@ -0,0 +1,123 @@
+#include <dis86_c.h>
+#include <dis86_instruction_stream.h>
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+static_assert(sizeof(dis86_operand) == 8, "dis86_operand is part of the ABI");
+static_assert(sizeof(dis86_inst) == 32, "dis86_inst is part of the ABI");
+static_assert(DIS86_MAX_INST_STR_LEN == MAX_INST_STR_LEN, "dis86_c.h is out of date");
+static_assert(DIS86_OPERAND_FAR_POINTER == (u8)OperandType::FAR_POINTER, "dis86_c.h is out of date");
+static_assert(DIS86_OPERAND_RELATIVE == (u8)OperandType::RELATIVE, "dis86_c.h is out of date");
+static_assert(DIS86_PREFIX_REPNE == (u8)RepPrefix::REPNE, "dis86_c.h is out of date");
+
+struct dis86_decoder {
+    InstStream instStream;
+    // decodes what's left after a failure with zeros after it, to tell a
+    // cut off instruction from an invalid one
+    InstStream tailStream;
+    u8 tail[MAX_INST_BYTES];
+    dis86_status status;
+
+    dis86_decoder()
+        : instStream(ByteSpan{nullptr, 0}), tailStream(ByteSpan{nullptr, 0}),
+          status(DIS86_OK) {}
+};
+
+static void ToCOperand(const Operand& op, dis86_operand& out) {
+    out.type = (u8)op.operandType;
+    out.index = op.GetIndex();
+    out.is_wide = op.IsWide();
+    out.reserved = 0;
+    out.value = op.GetValue();
+    out.segment = op.operandType == OperandType::FAR_POINTER ? op.farPointer.segment : 0;
+}
+
+static inline bool FromCOperand(const dis86_operand& op, Operand& out) {
+    return Operand::TryMake((OperandType)op.type, op.index, op.is_wide != 0, op.value,
+                            op.segment, out);
+}
+
+uint32_t dis86_abi_version(void) {
+    return DIS86_ABI_VERSION;
+}
+
+dis86_decoder *dis86_decoder_new(void) {
+    return new (std::nothrow) dis86_decoder();
+}
+
+void dis86_decoder_free(dis86_decoder *decoder) {
+    delete decoder;
+}
+
+size_t dis86_decode(dis86_decoder *decoder, const uint8_t *buf, size_t len,
+                    dis86_inst *out_insts, size_t cap) {
+    InstStream& instStream = decoder->instStream;
+    instStream.Restart(ByteSpan{buf, len});
+    decoder->status = DIS86_OK;
+
+    size_t count = 0;
+    Instruction inst;
+    while (count < cap && (inst = instStream.NextInstruction())) {
+        dis86_inst& out = out_insts[count++];
+        out.offset = inst.GetOffset();
+        out.op = (u8)inst.GetOpType();
+        out.length = inst.GetLength();
+        out.prefix = (u8)inst.GetPrefix();
+        std::memset(out.reserved, 0, sizeof(out.reserved));
+        ToCOperand(inst.GetOperand(0), out.operands[0]);
+        ToCOperand(inst.GetOperand(1), out.operands[1]);
+    }
+    if (!instStream.Failed()) {
+        return count;
+    }
+
+    decoder->status = DIS86_INVALID;
+    u64 remaining = len - instStream.GetOffset();
+    if (remaining < MAX_INST_BYTES) {
+        std::memset(decoder->tail, 0, sizeof(decoder->tail));
+        std::memcpy(decoder->tail, buf + instStream.GetOffset(), remaining);
+        decoder->tailStream.Restart(ByteSpan{decoder->tail, sizeof(decoder->tail)});
+        Instruction padded = decoder->tailStream.NextInstruction();
+        if (padded && padded.GetLength() > remaining) {
+            decoder->status = DIS86_TRUNCATED;
+        }
+    }
+    return count;
+}
+
+dis86_status dis86_decoder_status(const dis86_decoder *decoder) {
+    return decoder->status;
+}
+
+size_t dis86_format(const dis86_inst *inst, char *out, size_t cap) {
+    Operand operands[2] = {};
+    if (inst->op == (u8)OpType::NONE || inst->op >= (u8)OpType::NUM_OPS ||
+        inst->prefix > DIS86_PREFIX_REPNE ||
+        !FromCOperand(inst->operands[0], operands[0]) ||
+        !FromCOperand(inst->operands[1], operands[1])) {
+        if (cap > 0) {
+            out[0] = 0;
+        }
+        return 0;
+    }
+    Instruction decoded((OpType)inst->op, operands[0], operands[1]);
+    decoded.SetPrefix((RepPrefix)inst->prefix);
+
+    char text[MAX_INST_STR_LEN];
+    size_t textLen = decoded.Format(text) - text;
+    if (cap > 0) {
+        size_t numCopied = std::min(textLen, cap - 1);
+        std::memcpy(out, text, numCopied);
+        out[numCopied] = 0;
+    }
+    return textLen;
+}
+
+const char *dis86_op_name(uint8_t op) {
+    if (op >= (u8)OpType::NUM_OPS) {
+        return nullptr;
+    }
+    // the names are string literals, so already 0 terminated
+    return Instruction((OpType)op, {}, {}).GetOpStr().data();
+}
@@ -0,0 +1,304 @@
+#include <dis86_cfg.h>
+#include <dis86_bitmap.h>
+#include <dis86_endian.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#define CFG_MAGIC 0x47363844 // "D86G"
+#define CFG_VERSION 1
+// magic, version, numBlocks, numEdges
+#define CFG_HEADER_BYTES 16
+#define CFG_BLOCK_BYTES 20
+
+void ControlFlowGraph::AddInstruction(const Instruction& inst) {
+    assert(instOffsets.empty() || inst.GetOffset() >= instOffsets.back() + instLengths.back());
+    instOffsets.push_back(inst.GetOffset());
+    instLengths.push_back(inst.GetLength());
+    if (inst.IsControlFlow()) {
+        Branch branch;
+        branch.offset = inst.GetOffset();
+        branch.hasTarget = inst.GetBranchTarget(branch.target);
+        branch.isCall = inst.GetOpType() == OpType::CALL;
+        branch.fallsThrough = inst.FallsThrough();
+        branches.push_back(branch);
+    }
+}
+
+void ControlFlowGraph::Build() {
+    // bit per byte of the decoded range, set where an instruction starts
+    u64 base = instOffsets.empty() ? 0 : instOffsets.front();
+    u64 limit = instOffsets.empty() ? 0 : instOffsets.back() + instLengths.back();
+    Bitmap instStarts(limit - base);
+    for (u64 offset : instOffsets) {
+        instStarts.Set(offset - base);
+    }
+    auto isInstStart = [&](i64 offset) {
+        return offset >= (i64)base && (u64)offset < limit && instStarts.Test(offset - base);
+    };
+
+    // a block starts at the first instruction, after a gap, after control
+    // flow and at every branch target that is an instruction start
+    std::vector<u64> leaders;
+    auto branch = branches.begin();
+    for (u64 i = 0; i < instOffsets.size(); i++) {
+        if (i == 0 || instOffsets[i] != instOffsets[i - 1] + instLengths[i - 1]) {
+            leaders.push_back(instOffsets[i]);
+        }
+        if (branch != branches.end() && branch->offset == instOffsets[i]) {
+            if (i + 1 < instOffsets.size()) {
+                leaders.push_back(instOffsets[i + 1]);
+            }
+            if (branch->hasTarget && isInstStart(branch->target)) {
+                leaders.push_back(branch->target);
+            }
+            ++branch;
+        }
+    }
+    std::sort(leaders.begin(), leaders.end());
+    leaders.erase(std::unique(leaders.begin(), leaders.end()), leaders.end());
+    BuildBlocks(leaders);
+
+    // a block has at most two successors, the fall through and the target.
+    // control flow always ends a block, so a block holding one ends with it.
+    succStarts.assign(1, 0);
+    succs.clear();
+    succKinds.clear();
+    branch = branches.begin();
+    for (u32 blockIdx = 0; blockIdx < blocks.size(); blockIdx++) {
+        const BasicBlock& block = blocks[blockIdx];
+        while (branch != branches.end() && branch->offset < block.start) {
+            ++branch;
+        }
+        bool endsInBranch = branch != branches.end() && branch->offset < block.end;
+
+        bool fallsThrough = !endsInBranch || branch->fallsThrough;
+        if (fallsThrough && blockIdx + 1 < blocks.size() &&
+            blocks[blockIdx + 1].start == block.end) {
+            succs.push_back(blockIdx + 1);
+            succKinds.push_back(EdgeKind::FALL_THROUGH);
+        }
+        if (endsInBranch && branch->hasTarget && isInstStart(branch->target)) {
+            succs.push_back(FindBlock(branch->target));
+            succKinds.push_back(branch->isCall ? EdgeKind::CALL : EdgeKind::JUMP);
+        }
+        succStarts.push_back((u32)succs.size());
+    }
+    BuildPreds();
+
+    // the per instruction arrays are the biggest part, don't keep them
+    std::vector<u64>().swap(instOffsets);
+    std::vector<u8>().swap(instLengths);
+    std::vector<Branch>().swap(branches);
+}
+
+void ControlFlowGraph::BuildBlocks(std::vector<u64>& leaders) {
+    blocks.clear();
+    blocks.reserve(leaders.size());
+    auto leader = leaders.begin();
+    for (u64 i = 0; i < instOffsets.size(); i++) {
+        if (leader != leaders.end() && *leader == instOffsets[i]) {
+            blocks.push_back({instOffsets[i], instOffsets[i], 0});
+            ++leader;
+        }
+        blocks.back().end = instOffsets[i] + instLengths[i];
+        blocks.back().numInsts++;
+    }
+}
+
+void ControlFlowGraph::BuildPreds() {
+    // counting sort of the edges by target
+    predStarts.assign(blocks.size() + 1, 0);
+    for (u32 succ : succs) {
+        predStarts[succ + 1]++;
+    }
+    for (u32 i = 0; i < blocks.size(); i++) {
+        predStarts[i + 1] += predStarts[i];
+    }
+    preds.resize(succs.size());
+    std::vector<u32> next(predStarts.begin(), predStarts.end() - 1);
+    for (u32 blockIdx = 0; blockIdx < blocks.size(); blockIdx++) {
+        for (u32 e = succStarts[blockIdx]; e < succStarts[blockIdx + 1]; e++) {
+            preds[next[succs[e]]++] = blockIdx;
+        }
+    }
+}
+
+u32 ControlFlowGraph::NumBlocks() const {
+    return (u32)blocks.size();
+}
+
+u32 ControlFlowGraph::NumEdges() const {
+    return (u32)succs.size();
+}
+
+const BasicBlock& ControlFlowGraph::GetBlock(u32 blockIdx) const {
+    return blocks[blockIdx];
+}
+
+u32 ControlFlowGraph::FindBlock(u64 offset) const {
+    auto block = std::lower_bound(blocks.begin(), blocks.end(), offset,
+                                  [](const BasicBlock& b, u64 o) { return b.start < o; });
+    if (block == blocks.end() || block->start != offset) {
+        return (u32)blocks.size();
+    }
+    return (u32)(block - blocks.begin());
+}
+
+const u32 *ControlFlowGraph::SuccsBegin(u32 blockIdx) const {
+    return succs.data() + succStarts[blockIdx];
+}
+
+const u32 *ControlFlowGraph::SuccsEnd(u32 blockIdx) const {
+    return succs.data() + succStarts[blockIdx + 1];
+}
+
+const EdgeKind *ControlFlowGraph::SuccKinds(u32 blockIdx) const {
+    return succKinds.data() + succStarts[blockIdx];
+}
+
+const u32 *ControlFlowGraph::PredsBegin(u32 blockIdx) const {
+    return preds.data() + predStarts[blockIdx];
+}
+
+const u32 *ControlFlowGraph::PredsEnd(u32 blockIdx) const {
+    return preds.data() + predStarts[blockIdx + 1];
+}
+
+u64 ControlFlowGraph::MemoryUsage() const {
+    return blocks.capacity() * sizeof(BasicBlock) +
+           (succStarts.capacity() + succs.capacity() + predStarts.capacity() +
+            preds.capacity()) * sizeof(u32) +
+           succKinds.capacity() * sizeof(EdgeKind);
+}
+
+static char *WriteStr(char *out, const char *str) {
+    u64 len = std::strlen(str);
+    std::memcpy(out, str, len);
+    return out + len;
+}
+
+void ControlFlowGraph::WriteDot(OutputBuffer& out) const {
+    static const char *edgeAttrs[] = {
+        "",                                   // FALL_THROUGH
+        " [label=\"jump\"]",                  // JUMP
+        " [label=\"call\", style=dashed]",    // CALL
+    };
+    out.Write("digraph cfg {\n", 14);
+    for (u32 blockIdx = 0; blockIdx < blocks.size(); blockIdx++) {
+        // "    b4294967295 [label="<16 hex>-<16 hex>\n4294967295 insts"];"
+        char *line = out.Reserve(96);
+        line = WriteStr(line, "    b");
+        line = FormatInt(line, blockIdx);
+        line = WriteStr(line, " [label=\"");
+        line = FormatOffset(line, blocks[blockIdx].start);
+        *line++ = '-';
+        line = FormatOffset(line, blocks[blockIdx].end);
+        line = WriteStr(line, "\\n");
+        line = FormatInt(line, blocks[blockIdx].numInsts);
+        line = WriteStr(line, " insts\"];\n");
+        out.Commit(line);
+    }
+    for (u32 blockIdx = 0; blockIdx < blocks.size(); blockIdx++) {
+        for (u32 e = succStarts[blockIdx]; e < succStarts[blockIdx + 1]; e++) {
+            char *line = out.Reserve(96);
+            line = WriteStr(line, "    b");
+            line = FormatInt(line, blockIdx);
+            line = WriteStr(line, " -> b");
+            line = FormatInt(line, succs[e]);
+            line = WriteStr(line, edgeAttrs[(u8)succKinds[e]]);
+            line = WriteStr(line, ";\n");
+            out.Commit(line);
+        }
+    }
+    out.Write("}\n", 2);
+}
+
+void ControlFlowGraph::WriteBinary(OutputBuffer& out) const {
+    char *bytes = out.Reserve(CFG_HEADER_BYTES);
+    bytes = PutU32(bytes, CFG_MAGIC);
+    bytes = PutU32(bytes, CFG_VERSION);
+    bytes = PutU32(bytes, (u32)blocks.size());
+    bytes = PutU32(bytes, (u32)succs.size());
+    out.Commit(bytes);
+
+    for (const BasicBlock& block : blocks) {
+        bytes = out.Reserve(CFG_BLOCK_BYTES);
+        bytes = PutU64(bytes, block.start);
+        bytes = PutU64(bytes, block.end);
+        bytes = PutU32(bytes, block.numInsts);
+        out.Commit(bytes);
+    }
+    for (u32 succStart : succStarts) {
+        out.Commit(PutU32(out.Reserve(4), succStart));
+    }
+    for (u32 succ : succs) {
+        out.Commit(PutU32(out.Reserve(4), succ));
+    }
+    for (EdgeKind kind : succKinds) {
+        bytes = out.Reserve(1);
+        *bytes++ = (char)kind;
+        out.Commit(bytes);
+    }
+}
+
+bool ControlFlowGraph::ReadBinary(const u8 *bytes, u64 size) {
+    if (size < CFG_HEADER_BYTES || GetU32(bytes) != CFG_MAGIC ||
+        GetU32(bytes + 4) != CFG_VERSION) {
+        return false;
+    }
+    u64 numBlocks = GetU32(bytes + 8);
+    u64 numEdges = GetU32(bytes + 12);
+    if (size != CFG_HEADER_BYTES + numBlocks * CFG_BLOCK_BYTES + (numBlocks + 1) * 4 +
+                numEdges * 5) {
+        return false;
+    }
+    const u8 *in = bytes + CFG_HEADER_BYTES;
+
+    blocks.resize(numBlocks);
+    for (BasicBlock& block : blocks) {
+        block.start = GetU64(in);
+        block.end = GetU64(in + 8);
+        block.numInsts = GetU32(in + 16);
+        in += CFG_BLOCK_BYTES;
+    }
+    succStarts.resize(numBlocks + 1);
+    for (u32& succStart : succStarts) {
+        succStart = GetU32(in);
+        in += 4;
+    }
+    succs.resize(numEdges);
+    for (u32& succ : succs) {
+        succ = GetU32(in);
+        in += 4;
+        if (succ >= numBlocks) {
+            return false;
+        }
+    }
+    succKinds.resize(numEdges);
+    for (EdgeKind& kind : succKinds) {
+        if (*in > (u8)EdgeKind::CALL) {
+            return false;
+        }
+        kind = (EdgeKind)*in++;
+    }
+    if (succStarts[0] != 0 || succStarts[numBlocks] != numEdges ||
+        !std::is_sorted(succStarts.begin(), succStarts.end())) {
+        return false;
+    }
+    BuildPreds();
+    return true;
+}
+
+bool ControlFlowGraph::operator==(const ControlFlowGraph& rhs) const {
+    if (blocks.size() != rhs.blocks.size()) {
+        return false;
+    }
+    for (u32 i = 0; i < blocks.size(); i++) {
+        if (blocks[i].start != rhs.blocks[i].start || blocks[i].end != rhs.blocks[i].end ||
+            blocks[i].numInsts != rhs.blocks[i].numInsts) {
+            return false;
+        }
+    }
+    return succStarts == rhs.succStarts && succs == rhs.succs && succKinds == rhs.succKinds;
+}
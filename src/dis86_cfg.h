@@ -0,0 +1,86 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <dis86_basic_block.h>
+#include <dis86_instruction.h>
+#include <dis86_output_buffer.h>
+#include <vector>
+
+enum class EdgeKind : u8 {
+    FALL_THROUGH, // into the next block, including after a call or jcc
+    JUMP,         // taken side of jmp, jcc, loop and jcxz
+    CALL,
+};
+
+// control flow graph over basic blocks. edges are kept in compressed sparse
+// row form: the successors of block i are succs[succStarts[i]] up to
+// succs[succStarts[i + 1]], and the same for predecessors, so the whole
+// graph is a few flat arrays with no allocation per edge.
+//
+// jumps through registers or memory, far jumps and returns have no known
+// target and no successor edges. neither do branches out of the decoded
+// code or into the middle of an instruction.
+class ControlFlowGraph {
+public:
+    // instructions go in in address order, for example from a linear sweep
+    // or from a traversal's blocks. a gap between two instructions ends a
+    // block without a fall through edge.
+    void AddInstruction(const Instruction& inst);
+    // splits the instructions added so far into blocks and links them
+    void Build();
+
+    u32 NumBlocks() const;
+    u32 NumEdges() const;
+    const BasicBlock& GetBlock(u32 blockIdx) const;
+    // index of the block starting at offset, or NumBlocks() if there is none
+    u32 FindBlock(u64 offset) const;
+
+    // [first, last) ranges into the edge arrays
+    const u32 *SuccsBegin(u32 blockIdx) const;
+    const u32 *SuccsEnd(u32 blockIdx) const;
+    const EdgeKind *SuccKinds(u32 blockIdx) const;
+    const u32 *PredsBegin(u32 blockIdx) const;
+    const u32 *PredsEnd(u32 blockIdx) const;
+
+    // bytes held by the graph's arrays
+    u64 MemoryUsage() const;
+
+    // graphviz, one node per block labelled with its offset range
+    void WriteDot(OutputBuffer& out) const;
+    // little endian, all fields unsigned:
+    //   u32 magic "D86G", u32 version, u32 numBlocks, u32 numEdges
+    //   numBlocks x { u64 start, u64 end, u32 numInsts }
+    //   (numBlocks + 1) x u32 succStarts
+    //   numEdges x u32 succs
+    //   numEdges x u8 kinds
+    // predecessors are rebuilt on read
+    void WriteBinary(OutputBuffer& out) const;
+    // false if bytes is not a well formed graph
+    bool ReadBinary(const u8 *bytes, u64 size);
+
+    bool operator==(const ControlFlowGraph& rhs) const;
+
+private:
+    // what Build needs to know about a block ending instruction
+    struct Branch {
+        u64 offset;
+        i64 target;
+        bool hasTarget;
+        bool isCall;
+        bool fallsThrough;
+    };
+
+    // filled by AddInstruction, released by Build
+    std::vector<u64> instOffsets;
+    std::vector<u8> instLengths;
+    std::vector<Branch> branches;
+
+    std::vector<BasicBlock> blocks;
+    std::vector<u32> succStarts;
+    std::vector<u32> succs;
+    std::vector<EdgeKind> succKinds;
+    std::vector<u32> predStarts;
+    std::vector<u32> preds;
+
+    void BuildBlocks(std::vector<u64>& leaders);
+    void BuildPreds();
+};
@@ -0,0 +1,40 @@
+#include <dis86_decode_cache.h>
+#include <cassert>
+
+DecodeCache::DecodeCache(u32 numSets) : hits(0), misses(0) {
+    u32 roundedSets = 1;
+    while (roundedSets < numSets) {
+        roundedSets *= 2;
+    }
+    setMask = roundedSets - 1;
+    entries.reset(new Entry[(u64)roundedSets * DECODE_CACHE_WAYS]);
+    nextWays.reset(new u8[roundedSets]);
+    Clear();
+}
+
+void DecodeCache::Insert(const u8 *bytes, const Instruction& inst) {
+    assert(inst.GetLength() > 0 && inst.GetLength() <= MAX_INST_BYTES);
+    u32 setIdx = GetSetIdx(bytes);
+    u8 way = nextWays[setIdx];
+    nextWays[setIdx] = (way + 1) % DECODE_CACHE_WAYS;
+
+    Entry& entry = entries[setIdx * DECODE_CACHE_WAYS + way];
+    entry.mask = ((u64)1 << (inst.GetLength() * 8)) - 1;
+    entry.key = LoadBytes(bytes) & entry.mask;
+    entry.inst = inst;
+}
+
+void DecodeCache::ResetCounters() {
+    hits = 0;
+    misses = 0;
+}
+
+void DecodeCache::Clear() {
+    for (u64 setIdx = 0; setIdx <= setMask; setIdx++) {
+        for (u32 way = 0; way < DECODE_CACHE_WAYS; way++) {
+            entries[setIdx * DECODE_CACHE_WAYS + way].key = 0;
+            entries[setIdx * DECODE_CACHE_WAYS + way].mask = 0;
+        }
+        nextWays[setIdx] = 0;
+    }
+}
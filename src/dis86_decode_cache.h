@@ -0,0 +1,83 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <dis86_instruction.h>
+#include <dis86_inst_format.h>
+#include <memory>
+
+#define DECODE_CACHE_WAYS 4
+#define DEFAULT_DECODE_CACHE_SETS 1024
+
+// set associative cache from instruction bytes to the decoded instruction,
+// for inputs where the same instructions come up over and over (many builds
+// of the same program, overlays, compiler prologues). an 8086 instruction's
+// length is known from its first two bytes, so those pick the set (just the
+// first for one byte instructions) and an entry matches when all of its
+// bytes, up to MAX_INST_BYTES, are the same.
+//
+// it only pays off when hits are common, decoding is cheap enough that a
+// cache that mostly misses makes it slower. one cache can be shared by the
+// streams of one thread, it is not thread safe.
+class DecodeCache {
+public:
+    // numSets is rounded up to a power of 2
+    explicit DecodeCache(u32 numSets = DEFAULT_DECODE_CACHE_SETS);
+
+    // bytes must be readable for MAX_INST_BYTES, only the first numBytes
+    // are input. returns the cached instruction, location not set, or null.
+    inline const Instruction *Find(const u8 *bytes, u64 numBytes);
+    // inst was decoded from its GetLength() bytes at bytes
+    void Insert(const u8 *bytes, const Instruction& inst);
+
+    u64 GetHits() const { return hits; }
+    u64 GetMisses() const { return misses; }
+    void ResetCounters();
+    void Clear();
+
+private:
+    struct Entry {
+        // instruction bytes and a mask of the ones that count, a mask of 0
+        // is an empty entry
+        u64 key;
+        u64 mask;
+        Instruction inst;
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    // way each set replaces next, round robin
+    std::unique_ptr<u8[]> nextWays;
+    u32 setMask;
+    u64 hits;
+    u64 misses;
+
+    static inline u64 LoadBytes(const u8 *bytes) {
+        // MAX_INST_BYTES of them, little endian
+        u64 key = 0;
+        for (u32 i = 0; i < MAX_INST_BYTES; i++) {
+            key |= (u64)bytes[i] << (i * 8);
+        }
+        return key;
+    }
+    inline u32 GetSetIdx(const u8 *bytes) const {
+        // the byte after a one byte instruction belongs to the next one
+        u32 key = InstFormats::IsOneByteInstruction(bytes[0]) ?
+            bytes[0] : (bytes[0] | (bytes[1] << 8));
+        u32 hash = (key * 0x9e3779b1u) >> 16;
+        return hash & setMask;
+    }
+};
+
+inline const Instruction *DecodeCache::Find(const u8 *bytes, u64 numBytes) {
+    const Entry *set = &entries[GetSetIdx(bytes) * DECODE_CACHE_WAYS];
+    u64 key = LoadBytes(bytes);
+    // instructions running past the end of the input must not match
+    u64 validMask = (numBytes >= 8) ? ~(u64)0 : (((u64)1 << (numBytes * 8)) - 1);
+    for (u32 way = 0; way < DECODE_CACHE_WAYS; way++) {
+        u64 mask = set[way].mask;
+        if (mask != 0 && (mask & ~validMask) == 0 && (key & mask) == set[way].key) {
+            hits++;
+            return &set[way].inst;
+        }
+    }
+    misses++;
+    return nullptr;
+}
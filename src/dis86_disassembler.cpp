@@ -1,19 +1,483 @@
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <memory>
+#include <cstring>
+#include <dis86_batch.h>
+#include <dis86_cfg.h>
+#include <dis86_inst_file.h>
+#include <dis86_inst_format.h>
 #include <dis86_instruction_stream.h>
+#include <dis86_parallel.h>
+#include <dis86_scan.h>
+#include <dis86_labels.h>
+#include <dis86_server.h>
+#include <dis86_stats.h>
+#include <dis86_traversal.h>
+#include <vector>
 
-int main(int argc, char **argv) {
-    if (argc != 2) {
-        std::cerr << "please enter exactly 2 arguments" << std::endl;
-        std::exit(1);
+// byte values listed by --scan
+#define SCAN_TOP_BYTES 16
+
+struct Options {
+    std::vector<std::string> paths;
+    u32 numThreads = 1;
+    OutputFormat format = OutputFormat::TEXT;
+    bool labels = false;
+    bool traverse = false;
+    std::vector<u64> entryPoints;
+    // "dot" or "bin", writes the control flow graph instead of instructions
+    const char *cfg = nullptr;
+    // batch mode, more paths one per line in this file ("-" for stdin)
+    const char *filesFrom = nullptr;
+    // batch mode, one output file per input in this directory
+    const char *outDir = nullptr;
+    // serve requests on this unix socket with numThreads workers
+    const char *serve = nullptr;
+    // send the inputs to the server on this socket instead
+    const char *connect = nullptr;
+    // print a pre-scan of the file instead of disassembling it
+    bool scan = false;
+    std::vector<std::vector<u8>> patterns;
+    // "table" or "json", decode stats written to stderr at exit
+    const char *stats = nullptr;
+
+    bool IsBatch() const { return paths.size() > 1 || filesFrom || outDir; }
+};
+
+static void PrintUsage() {
+    std::cerr << "usage: dis86 [--threads N] [--offsets | --labels | --traverse [--entry OFFSET]...]\n"
+              << "             [--format text|listing|bin] [--cfg dot|bin] <file>\n"
+              << "       dis86 [options] [--files-from LIST|-] [--out-dir DIR] <file>...\n"
+              << "       dis86 [options] --serve SOCKET\n"
+              << "       dis86 --connect SOCKET <file>...\n"
+              << "       dis86 --scan [--pattern HEX]... <file>\n"
+              << "any of these can take --stats table|json, with a DIS86_STATS build\n"
+              << "with several files --threads is the number of files done at once"
+              << std::endl;
+}
+
+// "558bec" to { 0x55, 0x8b, 0xec }
+static bool ParseHex(const char *hex, std::vector<u8>& bytes) {
+    u64 len = std::strlen(hex);
+    if (len == 0 || len % 2 != 0) {
+        return false;
+    }
+    for (u64 i = 0; i < len; i += 2) {
+        char digits[3] = { hex[i], hex[i + 1], '\0' };
+        char *end;
+        bytes.push_back((u8)std::strtoul(digits, &end, 16));
+        if (end != digits + 2) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool ParseFormat(const char *name, OutputFormat& format) {
+    if (std::strcmp(name, "text") == 0) {
+        format = OutputFormat::TEXT;
+    } else if (std::strcmp(name, "listing") == 0) {
+        format = OutputFormat::LISTING;
+    } else if (std::strcmp(name, "bin") == 0) {
+        format = OutputFormat::BINARY;
+    } else {
+        return false;
     }
-    std::ifstream binfile(argv[1]);
+    return true;
+}
 
-    InstStream instStream(&binfile);
+static bool ParseArgs(int argc, char **argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.numThreads = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--offsets") == 0) {
+            options.format = OutputFormat::LISTING;
+        } else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (!ParseFormat(argv[++i], options.format)) {
+                return false;
+            }
+        } else if (std::strncmp(argv[i], "--format=", 9) == 0) {
+            if (!ParseFormat(argv[i] + 9, options.format)) {
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--labels") == 0) {
+            options.labels = true;
+        } else if (std::strcmp(argv[i], "--traverse") == 0) {
+            options.traverse = true;
+        } else if (std::strcmp(argv[i], "--entry") == 0 && i + 1 < argc) {
+            // decimal or 0x hex
+            options.entryPoints.push_back(std::strtoull(argv[++i], nullptr, 0));
+        } else if (std::strcmp(argv[i], "--cfg") == 0 && i + 1 < argc) {
+            options.cfg = argv[++i];
+            if (std::strcmp(options.cfg, "dot") != 0 && std::strcmp(options.cfg, "bin") != 0) {
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--files-from") == 0 && i + 1 < argc) {
+            options.filesFrom = argv[++i];
+        } else if (std::strcmp(argv[i], "--out-dir") == 0 && i + 1 < argc) {
+            options.outDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            options.serve = argv[++i];
+        } else if (std::strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+            options.connect = argv[++i];
+        } else if (std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            options.stats = argv[++i];
+            if (std::strcmp(options.stats, "table") != 0 && std::strcmp(options.stats, "json") != 0) {
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--scan") == 0) {
+            options.scan = true;
+        } else if (std::strcmp(argv[i], "--pattern") == 0 && i + 1 < argc) {
+            options.patterns.emplace_back();
+            if (!ParseHex(argv[++i], options.patterns.back())) {
+                return false;
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            return false;
+        } else {
+            options.paths.push_back(argv[i]);
+        }
+    }
+    // the output modes don't combine
+    if ((options.format != OutputFormat::TEXT) + options.labels + options.traverse > 1) {
+        return false;
+    }
+    if (!options.entryPoints.empty() && !options.traverse) {
+        return false;
+    }
+    // the graph is built from a linear sweep or from the traversal
+    if (options.cfg && (options.format != OutputFormat::TEXT || options.labels)) {
+        return false;
+    }
+    // binary graphs and instruction files can't be told apart once concatenated
+    if (options.IsBatch() && !options.outDir &&
+        ((options.cfg && std::strcmp(options.cfg, "bin") == 0) ||
+         options.format == OutputFormat::BINARY)) {
+        return false;
+    }
+    if (options.entryPoints.empty()) {
+        options.entryPoints.push_back(0);
+    }
+    if (!options.patterns.empty() && !options.scan) {
+        return false;
+    }
+    if (options.scan) {
+        // a report on one file, none of the output options apply
+        return options.paths.size() == 1 && !options.filesFrom && !options.outDir &&
+            !options.serve && !options.connect && !options.cfg && !options.traverse &&
+            !options.labels && options.format == OutputFormat::TEXT;
+    }
+    if (options.serve) {
+        return options.paths.empty() && !options.filesFrom && !options.connect;
+    }
+    return !options.paths.empty() || options.filesFrom;
+}
+
+static void WriteCfg(ControlFlowGraph& cfg, const Options& options, OutputBuffer& out) {
+    cfg.Build();
+    if (std::strcmp(options.cfg, "dot") == 0) {
+        cfg.WriteDot(out);
+    } else {
+        cfg.WriteBinary(out);
+    }
+}
+
+static bool Disassemble(InstStream& instStream, const Options& options, OutputBuffer& out) {
+    if (options.cfg) {
+        ControlFlowGraph cfg;
+        Instruction inst;
+        while (inst = instStream.NextInstruction()) {
+            cfg.AddInstruction(inst);
+        }
+        WriteCfg(cfg, options, out);
+        return !instStream.Failed();
+    }
+    if (options.labels) {
+        return DisassembleWithLabels(instStream, out);
+    }
+    OutputFormat format = options.format;
+    if (format == OutputFormat::BINARY) {
+        WriteInstFileHeader(out);
+    }
     Instruction inst;
     while (inst = instStream.NextInstruction()) {
-        inst.Print();
+        inst.Format(out, format, instStream.GetInstBytes());
+    }
+    return !instStream.Failed();
+}
+
+static void Traverse(ByteSpan image, const Options& options, u32 numThreads, OutputBuffer& out) {
+    Traversal traversal(image);
+    for (u64 entryPoint : options.entryPoints) {
+        traversal.AddEntryPoint(entryPoint);
+    }
+    traversal.Run(numThreads);
+    if (!options.cfg) {
+        traversal.Format(out);
+        return;
+    }
+    ControlFlowGraph cfg;
+    InstStream instStream(ByteSpan{image.data, 0});
+    for (const BasicBlock& block : traversal.GetBlocks()) {
+        instStream.Restart(ByteSpan{image.data + block.start, block.end - block.start},
+                           block.start);
+        for (u32 i = 0; i < block.numInsts; i++) {
+            cfg.AddInstruction(instStream.NextInstruction());
+        }
+    }
+    WriteCfg(cfg, options, out);
+}
+
+// what batch mode and the server do with each input, on one thread
+static bool DisassembleImage(ByteSpan image, InstStream& instStream, const Options& options,
+                             OutputBuffer& out) {
+    if (options.traverse) {
+        Traverse(image, options, 1, out);
+        return true;
+    }
+    return Disassemble(instStream, options, out);
+}
+
+static bool ReadFileList(const char *listPath, std::vector<std::string>& paths) {
+    std::ifstream listFile;
+    std::istream *list = &std::cin;
+    if (std::strcmp(listPath, "-") != 0) {
+        listFile.open(listPath);
+        if (!listFile) {
+            return false;
+        }
+        list = &listFile;
+    }
+    std::string line;
+    while (std::getline(*list, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            paths.push_back(line);
+        }
+    }
+    return true;
+}
+
+// the whole file, mapped when possible. false with a message if it can't be
+// read, fileBytes holds the bytes when it isn't mapped.
+static bool ReadImage(const char *path, MappedFileSource& mappedFile,
+                      std::vector<u8>& fileBytes, ByteSpan& image) {
+    if (mappedFile.IsOpen()) {
+        image = mappedFile.GetBytes();
+        return true;
     }
+    std::ifstream binfile(path, std::ios::binary);
+    if (!binfile) {
+        std::cerr << "could not open " << path << std::endl;
+        return false;
+    }
+    fileBytes.assign(std::istreambuf_iterator<char>(binfile), std::istreambuf_iterator<char>());
+    image = ByteSpan{fileBytes.data(), fileBytes.size()};
+    return true;
+}
+
+static void WriteScan(ByteSpan image, const Options& options, OutputBuffer& out) {
+    ScanResult result;
+    ScanImage(image, options.patterns, result);
+
+    std::string report = "; " + std::to_string(image.size) + " bytes, scanned with " +
+        GetScanIsaName(GetBestScanIsa()) + "\n";
+    f64 percent = image.size ? 100.0 * result.numValidStarts / image.size : 0;
+    report += "; valid instruction starts: " + std::to_string(result.numValidStarts) + " (" +
+        std::to_string((u32)(percent + 0.5)) + "%)\n";
+
+    static const char hexDigits[] = "0123456789abcdef";
+    // byte values by count, ties by value
+    std::vector<u32> byteValues(256);
+    for (u32 i = 0; i < 256; i++) {
+        byteValues[i] = i;
+    }
+    std::stable_sort(byteValues.begin(), byteValues.end(), [&](u32 lhs, u32 rhs) {
+        return result.histogram[lhs] > result.histogram[rhs];
+    });
+    report += "; most common bytes:\n";
+    for (u32 i = 0; i < SCAN_TOP_BYTES && result.histogram[byteValues[i]] > 0; i++) {
+        u32 byte = byteValues[i];
+        report += ";   ";
+        report += hexDigits[byte >> 4];
+        report += hexDigits[byte & 0xf];
+        report += " " + std::to_string(result.histogram[byte]) +
+            (InstFormats::CanStartInstruction((u8)byte) ? "\n" : " (not an opcode)\n");
+    }
+    out.Write(report.data(), report.size());
+
+    char offset[17];
+    for (u32 i = 0; i < options.patterns.size(); i++) {
+        report = "; pattern ";
+        for (u8 byte : options.patterns[i]) {
+            report += hexDigits[byte >> 4];
+            report += hexDigits[byte & 0xf];
+        }
+        report += ": " + std::to_string(result.matches[i].size()) + " matches\n";
+        out.Write(report.data(), report.size());
+        for (u64 matchOffset : result.matches[i]) {
+            char *end = FormatOffset(offset, matchOffset);
+            out.Write(offset, end - offset);
+            out.Write("\n", 1);
+        }
+    }
+}
+
+static int RunBatch(Options& options) {
+    if (options.filesFrom && !ReadFileList(options.filesFrom, options.paths)) {
+        std::cerr << "could not open " << options.filesFrom << std::endl;
+        return 1;
+    }
+    BatchOptions batchOptions;
+    batchOptions.numThreads = options.numThreads;
+    batchOptions.outDir = options.outDir;
+    if (options.cfg) {
+        batchOptions.outExt = (std::strcmp(options.cfg, "dot") == 0) ? ".dot" : ".cfg";
+    } else if (options.format == OutputFormat::BINARY) {
+        batchOptions.outExt = ".insts";
+    }
+
+    // the pool is the parallelism, each file is done on one thread
+    BatchStats stats = DisassembleBatch(options.paths, batchOptions, std::cout,
+        [&](ByteSpan image, InstStream& instStream, OutputBuffer& out) {
+            return DisassembleImage(image, instStream, options, out);
+        });
+
+    std::cerr << stats.numFiles << " files (" << stats.numFailed << " failed), "
+              << stats.numBytes << " bytes in " << stats.seconds << " s: "
+              << stats.numFiles / stats.seconds << " files/s, "
+              << stats.numBytes / stats.seconds / (1024 * 1024) << " MB/s" << std::endl;
+    return stats.numFailed ? 1 : 0;
+}
+
+static int RunServer(const Options& options) {
+    ServerOptions serverOptions;
+    serverOptions.socketPath = options.serve;
+    serverOptions.numWorkers = options.numThreads;
+    // runs until killed, a socket file left behind is replaced on the next start
+    Server server(serverOptions, [&](ByteSpan image, InstStream& instStream, OutputBuffer& out) {
+        return DisassembleImage(image, instStream, options, out);
+    });
+    if (!server.Start()) {
+        return 1;
+    }
+    server.Run();
     return 0;
-}
\ No newline at end of file
+}
+
+static int RunClient(const Options& options) {
+    Client client;
+    if (!client.Connect(options.connect)) {
+        std::cerr << "could not connect to " << options.connect << std::endl;
+        return 1;
+    }
+    int result = 0;
+    for (const std::string& path : options.paths) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "could not open " << path << std::endl;
+            result = 1;
+            continue;
+        }
+        std::vector<u8> code((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+        ServerStatus status;
+        std::string text;
+        if (!client.Disassemble(ByteSpan{code.data(), code.size()}, status, text)) {
+            std::cerr << "lost the connection to " << options.connect << std::endl;
+            return 1;
+        }
+        std::cout << text;
+        if (status != ServerStatus::OK) {
+            std::cerr << (status == ServerStatus::TOO_LARGE ? "too large: " : "failed to decode ")
+                      << path << std::endl;
+            result = 1;
+        }
+    }
+    return result;
+}
+
+static int Run(Options& options) {
+    if (options.serve) {
+        return RunServer(options);
+    }
+    if (options.connect) {
+        return RunClient(options);
+    }
+    if (options.IsBatch()) {
+        return RunBatch(options);
+    }
+    const char *path = options.paths[0].c_str();
+
+    // map the file when possible and decode straight out of the page cache,
+    // pipes and the like are read through a stream instead
+    MappedFileSource mappedFile(path);
+    OutputBuffer out(&std::cout);
+    if (options.traverse || options.scan) {
+        // control flow goes anywhere in the image, so all of it is needed
+        std::vector<u8> fileBytes;
+        ByteSpan image;
+        if (!ReadImage(path, mappedFile, fileBytes, image)) {
+            return 1;
+        }
+        if (options.scan) {
+            WriteScan(image, options, out);
+        } else {
+            Traverse(image, options, options.numThreads, out);
+        }
+        out.Flush();
+        return 0;
+    }
+
+    // the label pass and the graph need every target before writing
+    // anything, so they are single threaded
+    bool ok;
+    if (mappedFile.IsOpen() && options.numThreads > 1 && !options.labels && !options.cfg) {
+        // the records are written by the chunks like lines of text
+        if (options.format == OutputFormat::BINARY) {
+            WriteInstFileHeader(out);
+        }
+        ok = DisassembleParallel(mappedFile.GetBytes(), options.numThreads, out,
+                                 DEFAULT_PARALLEL_CHUNK_SIZE, options.format);
+    } else if (mappedFile.IsOpen()) {
+        InstStream instStream(&mappedFile);
+        ok = Disassemble(instStream, options, out);
+    } else {
+        std::ifstream binfile(path, std::ios::binary);
+        if (!binfile) {
+            std::cerr << "could not open " << path << std::endl;
+            return 1;
+        }
+        InstStream instStream(&binfile);
+        ok = Disassemble(instStream, options, out);
+    }
+    out.Flush();
+
+    if (!ok) {
+        std::cerr << "failed to decode instruction" << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        std::exit(1);
+    }
+#ifndef DIS86_STATS
+    if (options.stats) {
+        std::cerr << "--stats needs a build configured with -DDIS86_STATS=ON" << std::endl;
+        return 1;
+    }
+#endif
+    int result = Run(options);
+    if (options.stats) {
+        WriteStats(CollectStats(), std::strcmp(options.stats, "json") == 0, std::cerr);
+    }
+    return result;
+}
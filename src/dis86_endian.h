@@ -0,0 +1,34 @@
+#pragma once
+#include <dis86_num_types.h>
+
+// little endian reads and writes for the binary file formats and the server
+// protocol, the same bytes whatever the host's byte order. each Put returns
+// the byte after the ones it wrote.
+
+inline char *PutU16(char *out, u16 value) {
+    *out++ = (char)value;
+    *out++ = (char)(value >> 8);
+    return out;
+}
+
+inline char *PutU32(char *out, u32 value) {
+    out = PutU16(out, (u16)value);
+    return PutU16(out, (u16)(value >> 16));
+}
+
+inline char *PutU64(char *out, u64 value) {
+    out = PutU32(out, (u32)value);
+    return PutU32(out, (u32)(value >> 32));
+}
+
+inline u16 GetU16(const u8 *in) {
+    return (u16)(in[0] | (in[1] << 8));
+}
+
+inline u32 GetU32(const u8 *in) {
+    return GetU16(in) | ((u32)GetU16(in + 2) << 16);
+}
+
+inline u64 GetU64(const u8 *in) {
+    return GetU32(in) | ((u64)GetU32(in + 4) << 32);
+}
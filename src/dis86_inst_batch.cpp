@@ -0,0 +1,79 @@
+#include <dis86_inst_batch.h>
+#include <dis86_instruction_stream.h>
+#include <cassert>
+
+u64 InstBatch::Size() const {
+    return opTypes.size();
+}
+
+void InstBatch::Clear() {
+    opTypes.clear();
+    prefixes.clear();
+    for (u32 i = 0; i < 2; i++) {
+        operandTypes[i].clear();
+        operandIdxs[i].clear();
+        operandValues[i].clear();
+    }
+    offsets.clear();
+    lengths.clear();
+}
+
+void InstBatch::Reserve(u64 numInsts) {
+    opTypes.reserve(numInsts);
+    prefixes.reserve(numInsts);
+    for (u32 i = 0; i < 2; i++) {
+        operandTypes[i].reserve(numInsts);
+        operandIdxs[i].reserve(numInsts);
+        operandValues[i].reserve(numInsts);
+    }
+    offsets.reserve(numInsts);
+    lengths.reserve(numInsts);
+}
+
+void InstBatch::Push(const Instruction& inst) {
+    assert(inst.GetOffset() <= UINT32_MAX);
+    opTypes.push_back(inst.GetOpType());
+    prefixes.push_back(inst.GetPrefix());
+    for (u32 i = 0; i < 2; i++) {
+        const Operand& operand = inst.GetOperand(i);
+        operandTypes[i].push_back(operand.operandType);
+        operandIdxs[i].push_back(operand.GetIndex() | (operand.IsWide() ? WIDE_FLAG : 0));
+        operandValues[i].push_back(operand.GetValue());
+    }
+    if (operandTypes[0].back() == OperandType::FAR_POINTER) {
+        operandValues[1].back() = inst.GetOperand(0).farPointer.segment;
+    }
+    offsets.push_back((u32)inst.GetOffset());
+    lengths.push_back(inst.GetLength());
+}
+
+Instruction InstBatch::Get(u64 idx) const {
+    assert(idx < Size());
+    Operand operands[2];
+    for (u32 i = 0; i < 2; i++) {
+        u8 packedIdx = operandIdxs[i][idx];
+        operands[i] = Operand::Make(operandTypes[i][idx], packedIdx & ~WIDE_FLAG,
+            (packedIdx & WIDE_FLAG) != 0, operandValues[i][idx]);
+    }
+    if (operandTypes[0][idx] == OperandType::FAR_POINTER) {
+        operands[0] = Operand::MakeFarPointer(operandValues[1][idx], operandValues[0][idx]);
+    }
+    Instruction inst(opTypes[idx], operands[0], operands[1]);
+    inst.SetLocation(offsets[idx], lengths[idx]);
+    inst.SetPrefix(prefixes[idx]);
+    return inst;
+}
+
+bool DecodeBatch(ByteSpan bytes, InstBatch& out) {
+    assert(bytes.size <= UINT32_MAX);
+    out.Clear();
+    // most instructions are two to four bytes
+    out.Reserve(bytes.size / 3);
+
+    InstStream instStream(bytes);
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        out.Push(inst);
+    }
+    return !instStream.Failed();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <dis86_byte_source.h>
+#include <dis86_instruction.h>
+#include <vector>
+
+// decoded instructions stored column by column, so a pass that only looks at
+// e.g. the opcodes runs over one tightly packed array. Clear keeps the
+// allocations so a batch can be refilled without reallocating.
+class InstBatch {
+public:
+    std::vector<OpType> opTypes;
+    std::vector<RepPrefix> prefixes;
+    std::vector<OperandType> operandTypes[2];
+    // see Operand::GetIndex, with the width in the top bit
+    std::vector<u8> operandIdxs[2];
+    // displacements and immediates, far pointers keep their segment in the
+    // second operand's value
+    std::vector<u16> operandValues[2];
+    // position of each instruction relative to the start of the decoded bytes
+    std::vector<u32> offsets;
+    std::vector<u8> lengths;
+
+    static const u8 WIDE_FLAG = 0x80;
+
+    u64 Size() const;
+    void Clear();
+    void Reserve(u64 numInsts);
+    void Push(const Instruction& inst);
+
+    // rebuilds the Instruction at idx, for code written against Instruction
+    Instruction Get(u64 idx) const;
+};
+
+// decodes all of bytes into out (cleared first, its allocations are
+// reused). returns false if decoding stopped on an invalid instruction.
+bool DecodeBatch(ByteSpan bytes, InstBatch& out);
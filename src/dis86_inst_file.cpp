@@ -0,0 +1,109 @@
+#include <dis86_inst_file.h>
+#include <dis86_endian.h>
+#include <cassert>
+
+#define INST_FILE_MAGIC 0x49363844 // "D86I"
+#define INST_FILE_VERSION 1
+
+void WriteInstFileHeader(OutputBuffer& out) {
+    char *bytes = out.Reserve(INST_FILE_HEADER_BYTES);
+    bytes = PutU32(bytes, INST_FILE_MAGIC);
+    bytes = PutU32(bytes, INST_FILE_VERSION);
+    bytes = PutU32(bytes, INST_FILE_RECORD_BYTES);
+    bytes = PutU32(bytes, 0);
+    out.Commit(bytes);
+}
+
+static inline u8 PackOperand(const Operand& op) {
+    assert((u8)op.operandType < 8 && op.GetIndex() < 16);
+    return (u8)op.operandType | (op.IsWide() << 3) | (op.GetIndex() << 4);
+}
+
+static inline bool UnpackOperand(u8 packed, u16 value, u16 segment, Operand& op) {
+    return Operand::TryMake((OperandType)(packed & 7), packed >> 4, (packed >> 3) & 1,
+                            value, segment, op);
+}
+
+void WriteInstRecord(OutputBuffer& out, const Instruction& inst) {
+    const Operand& op0 = inst.GetOperand(0);
+    const Operand& op1 = inst.GetOperand(1);
+    assert(inst.GetLength() < 16);
+
+    char *bytes = out.Reserve(INST_FILE_RECORD_BYTES);
+    bytes = PutU64(bytes, inst.GetOffset());
+    *bytes++ = (char)inst.GetOpType();
+    *bytes++ = (char)(inst.GetLength() | ((u8)inst.GetPrefix() << 4));
+    *bytes++ = (char)PackOperand(op0);
+    *bytes++ = (char)PackOperand(op1);
+    bytes = PutU16(bytes, op0.GetValue());
+    if (op0.operandType == OperandType::FAR_POINTER) {
+        assert(op1.operandType == OperandType::NONE);
+        bytes = PutU16(bytes, op0.farPointer.segment);
+    } else {
+        bytes = PutU16(bytes, op1.GetValue());
+    }
+    out.Commit(bytes);
+}
+
+InstFileReader::InstFileReader() : records(nullptr), numInsts(0) {}
+
+bool InstFileReader::Open(const char *path) {
+    mappedFile.reset(new MappedFileSource(path));
+    if (!mappedFile->IsOpen()) {
+        mappedFile.reset();
+        records = nullptr;
+        numInsts = 0;
+        return false;
+    }
+    return Open(mappedFile->GetBytes());
+}
+
+bool InstFileReader::Open(ByteSpan bytes) {
+    records = nullptr;
+    numInsts = 0;
+    if (bytes.size < INST_FILE_HEADER_BYTES || GetU32(bytes.data) != INST_FILE_MAGIC ||
+        GetU32(bytes.data + 4) != INST_FILE_VERSION ||
+        GetU32(bytes.data + 8) != INST_FILE_RECORD_BYTES) {
+        return false;
+    }
+    // a partly written record means the file was cut off
+    u64 recordsSize = bytes.size - INST_FILE_HEADER_BYTES;
+    if (recordsSize % INST_FILE_RECORD_BYTES != 0) {
+        return false;
+    }
+    records = bytes.data + INST_FILE_HEADER_BYTES;
+    numInsts = recordsSize / INST_FILE_RECORD_BYTES;
+    return true;
+}
+
+u64 InstFileReader::GetNumInsts() const {
+    return numInsts;
+}
+
+bool InstFileReader::GetInst(u64 idx, Instruction& inst) const {
+    assert(idx < numInsts);
+    const u8 *record = records + idx * INST_FILE_RECORD_BYTES;
+    u8 op = record[8];
+    u8 length = record[9] & 0xf;
+    u8 prefix = record[9] >> 4;
+    u16 value0 = GetU16(record + 12);
+    u16 value1 = GetU16(record + 14);
+
+    Operand operands[2] = {};
+    if (op == (u8)OpType::NONE || op >= (u8)OpType::NUM_OPS ||
+        prefix > (u8)RepPrefix::REPNE || length == 0 ||
+        !UnpackOperand(record[10], value0, value1, operands[0]) ||
+        !UnpackOperand(record[11], value1, 0, operands[1])) {
+        return false;
+    }
+    // a far pointer takes both values, so it has to be the only operand
+    if (operands[1].operandType == OperandType::FAR_POINTER ||
+        (operands[0].operandType == OperandType::FAR_POINTER &&
+         operands[1].operandType != OperandType::NONE)) {
+        return false;
+    }
+    inst = Instruction((OpType)op, operands[0], operands[1]);
+    inst.SetLocation(GetU64(record), length);
+    inst.SetPrefix((RepPrefix)prefix);
+    return true;
+}
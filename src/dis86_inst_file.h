@@ -0,0 +1,41 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <dis86_byte_source.h>
+#include <dis86_instruction.h>
+#include <dis86_output_buffer.h>
+#include <memory>
+
+// decoded instructions saved as fixed size records (dis86 --format bin), so
+// the Nth one can be read straight out of a mapped file. little endian:
+//   u32 magic "D86I", u32 version, u32 record bytes, u32 reserved
+//   then to the end of the file one record per instruction:
+//   { u64 offset, u8 op, u8 length | prefix << 4,
+//     2 x u8 operand type | isWide << 3 | index << 4, 2 x u16 value }
+// far pointers keep the offset in the first value and the segment in the
+// second. there is no count in the header so records can be written out as
+// they are decoded, the reader works it out from the file size.
+#define INST_FILE_HEADER_BYTES 16
+#define INST_FILE_RECORD_BYTES 16
+
+void WriteInstFileHeader(OutputBuffer& out);
+void WriteInstRecord(OutputBuffer& out, const Instruction& inst);
+
+// reads the records in place, nothing is copied or allocated per record
+class InstFileReader {
+public:
+    InstFileReader();
+
+    // maps the file, false if it can't be mapped or isn't an instruction file
+    bool Open(const char *path);
+    // bytes already in memory, they must outlive the reader
+    bool Open(ByteSpan bytes);
+
+    u64 GetNumInsts() const;
+    // false if the record doesn't hold a valid instruction
+    bool GetInst(u64 idx, Instruction& inst) const;
+
+private:
+    std::unique_ptr<MappedFileSource> mappedFile;
+    const u8 *records;
+    u64 numInsts;
+};
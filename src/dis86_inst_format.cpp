@@ -1,211 +1,247 @@
 #include <array>
-#include <dis86_instruction_stream.h>
+#include <dis86_inst_format.h>
 #include <cassert>
 #include <iostream>
-#include <unordered_map>
+#include <utility>
 
-static const BitField BitLiteral(u8 bits, u8 size) {
+static constexpr BitField BitLiteral(u8 bits, u8 size) {
     return {BitsUsage::Opcode, size, bits};
 }
 
-static const BitField D_BIT = {BitsUsage::Direction, 1}; 
-static const BitField S_BIT = {BitsUsage::SignExt, 1};
-static const BitField V_BIT = {BitsUsage::IsShiftCL, 1};
-static const BitField W_BIT = {BitsUsage::Width, 1};
-static const BitField MOD_BITS = {BitsUsage::Mod, 2};
-static const BitField REG_BITS = {BitsUsage::Reg, 3};
-static const BitField SR_BITS = {BitsUsage::SR, 2};
-static const BitField RM_BITS = {BitsUsage::RegMem, 3};
-
-static const BitField HAS_DATA = {BitsUsage::HasData, 0, 1};
-static const BitField WDATA_IF_W = {BitsUsage::WDataIfW, 0, 1};
-static const BitField RM_IS_W = {BitsUsage::RMIsW, 0, 1};
-
-static std::unordered_map<OpType, u8> BINARY_OP_LITS = {
-    {OpType::ADD, 0},
-    {OpType::OR, 1},
-    {OpType::ADC, 2},
-    {OpType::SBB, 3},
-    {OpType::AND, 4},
-    {OpType::SUB, 5},
-    {OpType::XOR, 6},
-    {OpType::CMP, 7},
-};
+static constexpr BitField D_BIT = {BitsUsage::Direction, 1}; 
+static constexpr BitField S_BIT = {BitsUsage::SignExt, 1};
+static constexpr BitField V_BIT = {BitsUsage::IsShiftCL, 1};
+static constexpr BitField W_BIT = {BitsUsage::Width, 1};
+static constexpr BitField MOD_BITS = {BitsUsage::Mod, 2};
+static constexpr BitField REG_BITS = {BitsUsage::Reg, 3};
+static constexpr BitField SR_BITS = {BitsUsage::SR, 2};
+static constexpr BitField RM_BITS = {BitsUsage::RegMem, 3};
+
+static constexpr BitField HAS_DATA = {BitsUsage::HasData, 0, 1};
+static constexpr BitField WDATA_IF_W = {BitsUsage::WDataIfW, 0, 1};
+static constexpr BitField RM_IS_W = {BitsUsage::RMIsW, 0, 1};
+static constexpr BitField REL8 = {BitsUsage::RelSize, 0, 1};
+static constexpr BitField REL16 = {BitsUsage::RelSize, 0, 2};
+static constexpr BitField HAS_FAR_PTR = {BitsUsage::HasFarPtr, 0, 1};
+
+// reg field literal of the immediate to register/memory binary ops
+static constexpr u8 BinaryOpLit(OpType type) {
+    switch (type) {
+        case OpType::ADD: return 0;
+        case OpType::OR: return 1;
+        case OpType::ADC: return 2;
+        case OpType::SBB: return 3;
+        case OpType::AND: return 4;
+        case OpType::SUB: return 5;
+        case OpType::XOR: return 6;
+        case OpType::CMP: return 7;
+        default:
+            assert(false && "not a binary op");
+            return 0;
+    }
+}
 
 enum class OpDirection {
     ModFirst = 0,
     RegFirst = 1
 };
 
-static const BitField DummyD(OpDirection val) {
+static constexpr BitField DummyD(OpDirection val) {
     return {BitsUsage::Direction, 0, (u8)val};
 }
 
-static const BitField DummyW(u8 val) {
+static constexpr BitField DummyW(u8 val) {
     return {BitsUsage::Width, 0, val};
 }
 
-static const BitField DummyReg(u8 val) {
+static constexpr BitField DummyReg(u8 val) {
     return {BitsUsage::Reg, 0, val};
 }
 
-static const BitField DummyRM(u8 val) {
+static constexpr BitField DummyRM(u8 val) {
     return {BitsUsage::RegMem, 0, val};
 }
 
-static const BitField DummyMod(u8 val) {
+static constexpr BitField DummyMod(u8 val) {
     return {BitsUsage::Mod, 0, val};
 }
 
-static const InstructionFormat RM2Reg(OpType type, BitField opField) {
+static constexpr InstructionFormat RM2Reg(OpType type, BitField opField) {
     assert(opField.numBits == 6);
     return { type, {{ opField, D_BIT, W_BIT,
         MOD_BITS, REG_BITS, RM_BITS}} };
 }
 
-static const InstructionFormat MovImm2RM(OpType type, BitField opField) {
+static constexpr InstructionFormat MovImm2RM(OpType type, BitField opField) {
     return { type, {{ opField, W_BIT,
         MOD_BITS, BitLiteral(0b000, 3), RM_BITS,
         HAS_DATA, WDATA_IF_W, DummyD(OpDirection::ModFirst) }} };
 }
 
-static const InstructionFormat Imm2Reg(OpType type, BitField opField) {
+static constexpr InstructionFormat Imm2Reg(OpType type, BitField opField) {
     return { type, {{ opField, W_BIT, REG_BITS,
         HAS_DATA, WDATA_IF_W, DummyD(OpDirection::RegFirst) }} };
 }
 
-static const InstructionFormat MovMem2Acc() {
+static constexpr InstructionFormat MovMem2Acc() {
     return { OpType::MOV, {{ BitLiteral(0b1010000, 7), W_BIT,
         DummyMod(0b00), DummyReg(0b000), DummyRM(0b110),
         DummyD(OpDirection::RegFirst)}} };
 }
 
-static const InstructionFormat MovAcc2Mem() {
+static constexpr InstructionFormat MovAcc2Mem() {
     return { OpType::MOV, {{ BitLiteral(0b1010001, 7), W_BIT,
         DummyMod(0b00), DummyReg(0b000), DummyRM(0b110),
         DummyD(OpDirection::ModFirst)}} };
 }
 
-static const InstructionFormat MovSR2RM() {
+static constexpr InstructionFormat MovSR2RM() {
     return { OpType::MOV, {{ BitLiteral(0b100011, 6), D_BIT, BitLiteral(0b0, 1),
         MOD_BITS, BitLiteral(0b0, 1), SR_BITS, RM_BITS }} };
 }
 
-static const InstructionFormat OpImm2RM(OpType type, BitField opField) {
+static constexpr InstructionFormat OpImm2RM(OpType type, BitField opField) {
     assert(opField.numBits == 6);
-    u8 lit = BINARY_OP_LITS.at(type);
+    u8 lit = BinaryOpLit(type);
     return { type, {{ opField, S_BIT, W_BIT,
         MOD_BITS, BitLiteral(lit, 3), RM_BITS,
         HAS_DATA, WDATA_IF_W, DummyD(OpDirection::ModFirst) }} };
 }
 
-static const InstructionFormat ImmOpAcc(OpType type, BitField opField) {
+static constexpr InstructionFormat ImmOpAcc(OpType type, BitField opField) {
     assert(opField.numBits == 7);
     return { type, {{ opField, W_BIT, DummyReg(0b000), HAS_DATA, WDATA_IF_W,
         DummyD(OpDirection::RegFirst)}} };
 }
 
-static const InstructionFormat PushRM() {
+static constexpr InstructionFormat PushRM() {
     return { OpType::PUSH , {{ BitLiteral(0b11111111, 8),
         MOD_BITS, BitLiteral(0b110, 3), RM_BITS,
         DummyW(true)}} };
 }
 
-static const InstructionFormat PopRM() {
+static constexpr InstructionFormat PopRM() {
     return { OpType::POP , {{ BitLiteral(0b10001111, 8),
         MOD_BITS, BitLiteral(0b000, 3), RM_BITS,
         DummyW(true)}} };
 }
 
-static const InstructionFormat OpReg(OpType type, BitField opField) {
+static constexpr InstructionFormat OpReg(OpType type, BitField opField) {
     return { type, {{ opField, REG_BITS, DummyW(true)}} };
 }
 
-static const InstructionFormat OpSR(OpType type, BitField opField1, BitField opField2) {
+static constexpr InstructionFormat OpSR(OpType type, BitField opField1, BitField opField2) {
     return { type, {{ opField1, SR_BITS, opField2}} };
 }
 
-static const InstructionFormat PushSR() {
+static constexpr InstructionFormat PushSR() {
     return { OpType::PUSH, {{ BitLiteral(0b000, 3), SR_BITS, BitLiteral(0b110, 3) }} };
 }
 
-static const InstructionFormat PopSR() {
+static constexpr InstructionFormat PopSR() {
     return { OpType::POP, {{ BitLiteral(0b000, 3), SR_BITS, BitLiteral(0b111, 3) }} };
 }
 
-static const InstructionFormat XCHGRegRM() {
+static constexpr InstructionFormat XCHGRegRM() {
     return { OpType::XCHG, {{ BitLiteral(0b1000011, 7), W_BIT,
         MOD_BITS, REG_BITS, RM_BITS }} };
 }
 
-static const InstructionFormat XCHGRegAcc() {
+static constexpr InstructionFormat XCHGRegAcc() {
     return { OpType::XCHG, {{ BitLiteral(0b10010, 5), REG_BITS, DummyW(true), DummyRM(0b000), DummyMod(0b11) }} };
 }
 
-static const InstructionFormat InPort2Acc() {
+static constexpr InstructionFormat InPort2Acc() {
     return { OpType::IN, {{ BitLiteral(0b1110010, 7), W_BIT,
         HAS_DATA, DummyReg(0), DummyD(OpDirection::RegFirst) }} };
 }
 
-static const InstructionFormat OutAcc2Port() {
+static constexpr InstructionFormat OutAcc2Port() {
     return { OpType::OUT, {{ BitLiteral(0b1110011, 7), W_BIT,
         HAS_DATA, DummyReg(0), DummyD(OpDirection::ModFirst) }} };
 }
 
-static const InstructionFormat InDX2Acc() {
+static constexpr InstructionFormat InDX2Acc() {
     return { OpType::IN, {{ BitLiteral(0b1110110, 7), W_BIT,
         DummyReg(0b000), DummyD(OpDirection::RegFirst),
         DummyMod(0b11), DummyRM(0b10), RM_IS_W }} };
 }
 
-static const InstructionFormat OutDX2Acc() {
+static constexpr InstructionFormat OutDX2Acc() {
     return { OpType::OUT, {{ BitLiteral(0b1110111, 7), W_BIT,
         DummyReg(0b000), DummyD(OpDirection::ModFirst),
         DummyMod(0b11), DummyRM(0b10), RM_IS_W }} };
 }
 
-static const InstructionFormat InstOnly(OpType type, u8 bits) {
+static constexpr InstructionFormat InstOnly(OpType type, u8 bits) {
     return { type, {{ BitLiteral(bits, 8) }} };
 }
 
-static const InstructionFormat LEA() {
+static constexpr InstructionFormat LEA() {
     return { OpType::LEA, {{ BitLiteral(0b10001101, 8),
         MOD_BITS, REG_BITS, RM_BITS,
         DummyD(OpDirection::RegFirst), DummyW(true) }} };
 }
 
-static const InstructionFormat LDS() {
+static constexpr InstructionFormat LDS() {
     return { OpType::LDS, {{ BitLiteral(0b11000101, 8),
         MOD_BITS, REG_BITS, RM_BITS,
         DummyD(OpDirection::RegFirst), DummyW(true) }} };
 }
 
-static const InstructionFormat LES() {
+static constexpr InstructionFormat LES() {
     return { OpType::LES, {{ BitLiteral(0b11000100, 8),
         MOD_BITS, REG_BITS, RM_BITS,
         DummyD(OpDirection::RegFirst), DummyW(true) }} };
 }
 
-static const InstructionFormat OpRMWithW(OpType type, u8 opBits, u8 literalBits) {
+static constexpr InstructionFormat OpRMWithW(OpType type, u8 opBits, u8 literalBits) {
     return { type, {{ BitLiteral(opBits, 7), W_BIT,
         MOD_BITS, BitLiteral(literalBits, 3), RM_BITS }} };
 }
 
-static const InstructionFormat OpRMWithVW(OpType type, u8 opBits, u8 literalBits) {
+static constexpr InstructionFormat OpRMWithVW(OpType type, u8 opBits, u8 literalBits) {
     return { type, {{ BitLiteral(opBits, 6), V_BIT, W_BIT,
         MOD_BITS, BitLiteral(literalBits, 3), RM_BITS,
         DummyD(OpDirection::ModFirst) }} };
 }
 
-static const InstructionFormat AAM() {
+static constexpr InstructionFormat Jump(OpType type, u8 bits, BitField relField) {
+    return { type, {{ BitLiteral(bits, 8), relField }} };
+}
+
+// conditional jumps are 0x70 + condition, in the same order as OpType
+static constexpr InstructionFormat CondJump(OpType type) {
+    return Jump(type, 0x70 + ((u8)type - (u8)OpType::JO), REL8);
+}
+
+static constexpr InstructionFormat FarJump(OpType type, u8 bits) {
+    return { type, {{ BitLiteral(bits, 8), HAS_FAR_PTR }} };
+}
+
+// ff /2 - /5, near indirect takes a word, far indirect a dword
+static constexpr InstructionFormat IndirectJump(OpType type, u8 literalBits) {
+    return { type, {{ BitLiteral(0b11111111, 8),
+        MOD_BITS, BitLiteral(literalBits, 3), RM_BITS,
+        DummyW(true) }} };
+}
+
+static constexpr InstructionFormat InstWithImm(OpType type, u8 bits, bool isWide) {
+    return { type, {{ BitLiteral(bits, 8), HAS_DATA, WDATA_IF_W, DummyW(isWide) }} };
+}
+
+static constexpr InstructionFormat AAM() {
     return { OpType::AAM, {{ BitLiteral(0b11010100, 8), BitLiteral(0b00001010, 8) }} };
 }
 
-static const InstructionFormat AAD() {
+static constexpr InstructionFormat AAD() {
     return { OpType::AAD, {{ BitLiteral(0b11010101, 8), BitLiteral(0b00001010, 8) }} };
 }
 
-const InstructionFormat InstStream::formats[] = {
+// the tables below are built from this at compile time. InstFormats' own
+// copies are defined const, not constexpr: a constexpr static member is an
+// inline variable, and the other files only see the plain const declaration
+static constexpr std::array<InstructionFormat, NUM_FORMATS> formatList = {{
     // mov instructions
     RM2Reg(OpType::MOV, BitLiteral(0b100010, 6)),
     MovImm2RM(OpType::MOV, BitLiteral(0b1100011, 7)),
@@ -307,4 +343,294 @@ const InstructionFormat InstStream::formats[] = {
     OpRMWithVW(OpType::RCL, 0b110100, 0b010),
     OpRMWithVW(OpType::RCR, 0b110100, 0b011),
 
+    // conditional jumps
+    CondJump(OpType::JO),
+    CondJump(OpType::JNO),
+    CondJump(OpType::JB),
+    CondJump(OpType::JNB),
+    CondJump(OpType::JE),
+    CondJump(OpType::JNE),
+    CondJump(OpType::JBE),
+    CondJump(OpType::JA),
+    CondJump(OpType::JS),
+    CondJump(OpType::JNS),
+    CondJump(OpType::JP),
+    CondJump(OpType::JNP),
+    CondJump(OpType::JL),
+    CondJump(OpType::JNL),
+    CondJump(OpType::JLE),
+    CondJump(OpType::JG),
+
+    // loops
+    Jump(OpType::LOOPNZ, 0b11100000, REL8),
+    Jump(OpType::LOOPZ, 0b11100001, REL8),
+    Jump(OpType::LOOP, 0b11100010, REL8),
+    Jump(OpType::JCXZ, 0b11100011, REL8),
+
+    // jmp
+    Jump(OpType::JMP, 0b11101001, REL16),
+    Jump(OpType::JMP, 0b11101011, REL8),
+    FarJump(OpType::JMP, 0b11101010),
+    IndirectJump(OpType::JMP, 0b100),
+    IndirectJump(OpType::JMP_FAR, 0b101),
+
+    // call
+    Jump(OpType::CALL, 0b11101000, REL16),
+    FarJump(OpType::CALL, 0b10011010),
+    IndirectJump(OpType::CALL, 0b010),
+    IndirectJump(OpType::CALL_FAR, 0b011),
+
+    // ret
+    InstOnly(OpType::RET, 0b11000011),
+    InstWithImm(OpType::RET, 0b11000010, true),
+    InstOnly(OpType::RETF, 0b11001011),
+    InstWithImm(OpType::RETF, 0b11001010, true),
+
+    // interrupts
+    InstWithImm(OpType::INT, 0b11001101, false),
+    InstOnly(OpType::INT3, 0b11001100),
+    InstOnly(OpType::INTO, 0b11001110),
+    InstOnly(OpType::IRET, 0b11001111),
+
+    // string instructions, rep prefixes are handled by InstStream
+    InstOnly(OpType::MOVSB, 0b10100100),
+    InstOnly(OpType::MOVSW, 0b10100101),
+    InstOnly(OpType::CMPSB, 0b10100110),
+    InstOnly(OpType::CMPSW, 0b10100111),
+    InstOnly(OpType::STOSB, 0b10101010),
+    InstOnly(OpType::STOSW, 0b10101011),
+    InstOnly(OpType::LODSB, 0b10101100),
+    InstOnly(OpType::LODSW, 0b10101101),
+    InstOnly(OpType::SCASB, 0b10101110),
+    InstOnly(OpType::SCASW, 0b10101111),
+}};
+static_assert(formatList[NUM_FORMATS - 1].op != OpType::NONE,
+    "NUM_FORMATS is larger than the format list");
+
+const std::array<InstructionFormat, NUM_FORMATS> InstFormats::formats = formatList;
+
+// gets the literal bits a format expects in its first two bytes, the first
+// byte is stored in the high half of the mask/value
+static constexpr void GetLiteralBits(const InstructionFormat& format, u16 &mask, u16 &val) {
+    mask = 0;
+    val = 0;
+    u32 bitPos = 0;
+    for (BitField field : format.fields) {
+        if ((field.name == BitsUsage::Opcode) && (field.numBits == 0)) {
+            break;
+        }
+        if (field.numBits == 0) {
+            continue;
+        }
+        if (field.name == BitsUsage::Opcode && bitPos + field.numBits <= 16) {
+            u32 shift = 16 - bitPos - field.numBits;
+            mask |= ((1 << field.numBits) - 1) << shift;
+            val |= field.val << shift;
+        }
+        bitPos += field.numBits;
+    }
+}
+
+constexpr std::array<InstFormats::FormatLiterals, NUM_FORMATS> InstFormats::BuildFormatLiterals() {
+    std::array<FormatLiterals, NUM_FORMATS> literals = {};
+    for (u32 i = 0; i < NUM_FORMATS; i++) {
+        GetLiteralBits(formatList[i], literals[i].mask, literals[i].val);
+    }
+    return literals;
+}
+
+constexpr InstFormats::DispatchTable InstFormats::BuildDispatchTable() {
+    // only the first byte and the reg field of the second byte are used to pick
+    // a format. the remaining literal bits (e.g. the 0x0a of aam) are still
+    // checked when decoding.
+    constexpr u16 PROBE_MASK = 0xff38;
+
+    std::array<FormatLiterals, NUM_FORMATS> literals = BuildFormatLiterals();
+
+    DispatchTable table = {};
+    for (u32 opByte = 0; opByte < 256; opByte++) {
+        for (u32 regField = 0; regField < 8; regField++) {
+            u16 probe = (opByte << 8) | (regField << 3);
+            table[opByte][regField] = NO_FORMAT;
+            for (u32 i = 0; i < NUM_FORMATS; i++) {
+                u16 mask = literals[i].mask & PROBE_MASK;
+                if ((probe & mask) == (literals[i].val & mask)) {
+                    // earlier formats take priority, same as the linear scan
+                    table[opByte][regField] = i;
+                    break;
+                }
+            }
+        }
+    }
+    return table;
+}
+
+const InstFormats::DispatchTable InstFormats::dispatchTable = BuildDispatchTable();
+
+// true if the format's bit fields fit in the first byte and nothing follows
+// them, i.e. no data, displacement, jump offset or far pointer
+static constexpr bool IsOneByteFormat(const InstructionFormat& format) {
+    u32 bitPos = 0;
+    for (BitField field : format.fields) {
+        if ((field.name == BitsUsage::Opcode) && (field.numBits == 0)) {
+            break;
+        }
+        bitPos += field.numBits;
+        switch (field.name) {
+            case BitsUsage::HasData:
+            case BitsUsage::HasDisp:
+            case BitsUsage::RelSize:
+            case BitsUsage::HasFarPtr:
+                return false;
+            case BitsUsage::Mod:
+                // a fixed memory mod, e.g. mov ax, [1234], takes an address
+                if (field.numBits == 0 && field.val != 0b11) {
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return bitPos <= 8;
+}
+
+constexpr std::array<bool, 256> InstFormats::BuildOneByteInstructions() {
+    DispatchTable dispatch = BuildDispatchTable();
+    std::array<bool, 256> table = {};
+    for (u32 opByte = 0; opByte < 256; opByte++) {
+        bool hasFormat = false;
+        bool allOneByte = true;
+        for (u8 formatIdx : dispatch[opByte]) {
+            if (formatIdx != NO_FORMAT) {
+                hasFormat = true;
+                allOneByte = allOneByte && IsOneByteFormat(formatList[formatIdx]);
+            }
+        }
+        table[opByte] = hasFormat && allOneByte;
+    }
+    return table;
+}
+
+const std::array<bool, 256> InstFormats::oneByteInstructions = BuildOneByteInstructions();
+
+OpType InstFormats::GetFormatOpType(u32 formatIdx) {
+    assert(formatIdx < NUM_FORMATS);
+    return formats[formatIdx].op;
+}
+
+bool InstFormats::CanStartInstruction(u8 byte) {
+    if ((byte & 0b11111110) == 0b11110010) {
+        return true;
+    }
+    for (u8 formatIdx : dispatchTable[byte]) {
+        if (formatIdx != NO_FORMAT) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// compile-time decoders: each format gets its own decode function where the
+// bit fields are pulled out of the instruction bytes with fixed shifts and
+// masks instead of walking the field list like GetBitFields does.
+
+struct FieldLayout {
+    u8 byteIdx = 0;
+    u8 shift = 0;
+    u8 mask = 0; // zero if the field has no bits, i.e. val is used as is
+    u8 val = 0;
+};
+
+struct FormatLayout {
+    u8 numBytes = 0;
+    u8 literalMask[2] = {};
+    u8 literalVal[2] = {};
+    u32 bitFieldFlags = 0;
+    std::array<FieldLayout, BitsUsage::NumElements> fields = {};
 };
+
+static constexpr FormatLayout GetFormatLayout(const InstructionFormat& format) {
+    FormatLayout layout = {};
+    u32 bitPos = 0;
+    for (BitField field : format.fields) {
+        if ((field.name == BitsUsage::Opcode) && (field.numBits == 0)) {
+            break;
+        }
+
+        FieldLayout& fieldLayout = layout.fields[field.name];
+        fieldLayout.val = field.val;
+        if (field.numBits != 0) {
+            u8 byteIdx = bitPos / 8;
+            assert(byteIdx < 2);
+            // fields never straddle a byte, see GetBitFields
+            assert((bitPos % 8) + field.numBits <= 8);
+            u8 shift = 8 - (bitPos % 8) - field.numBits;
+            u8 mask = (1 << field.numBits) - 1;
+
+            if (field.name == BitsUsage::Opcode) {
+                layout.literalMask[byteIdx] |= mask << shift;
+                layout.literalVal[byteIdx] |= field.val << shift;
+            }
+            fieldLayout.byteIdx = byteIdx;
+            fieldLayout.shift = shift;
+            fieldLayout.mask = mask;
+            bitPos += field.numBits;
+            layout.numBytes = byteIdx + 1;
+        }
+        layout.bitFieldFlags |= (1 << field.name);
+    }
+    return layout;
+}
+
+template<u32 FormatIdx>
+Instruction InstStream::DecodeFormat() {
+    static constexpr FormatLayout layout = GetFormatLayout(formatList[FormatIdx]);
+    static_assert(layout.numBytes >= 1 && layout.numBytes <= 2,
+        "formats are expected to use one or two bytes of bit fields");
+
+    // only looked at until the literal bits match, so a mismatch leaves
+    // the stream where it was
+    u8 instBytes[2] = {};
+    instBytes[0] = readPointer[0];
+    if (layout.numBytes == 2) {
+        instBytes[1] = readPointer[1];
+    }
+    // NextInstruction has already counted the probe
+    if (((instBytes[0] & layout.literalMask[0]) != layout.literalVal[0]) ||
+        ((instBytes[1] & layout.literalMask[1]) != layout.literalVal[1])) {
+        return {};
+    }
+    counters.numAttempts++;
+    readPointer += layout.numBytes;
+
+    // layout is a constant so this loop folds into a fixed shift and mask
+    // (or a constant) per field
+    std::array<u32, BitsUsage::NumElements> bitFieldValues = {};
+    for (u32 i = 0; i < BitsUsage::NumElements; i++) {
+        const FieldLayout& field = layout.fields[i];
+        bitFieldValues[i] = field.mask ?
+            (instBytes[field.byteIdx] >> field.shift) & field.mask : field.val;
+    }
+
+    return BuildInstruction(formatList[FormatIdx].op, layout.bitFieldFlags, bitFieldValues.data());
+}
+
+template<size_t... FormatIdxs>
+constexpr InstFormats::DecoderTable InstFormats::BuildDecoderTable(std::index_sequence<FormatIdxs...>) {
+    constexpr DecodeFn formatDecoders[] = { &InstStream::DecodeFormat<FormatIdxs>... };
+
+    DispatchTable dispatch = BuildDispatchTable();
+    DecoderTable table = {};
+    for (u32 opByte = 0; opByte < 256; opByte++) {
+        for (u32 regField = 0; regField < 8; regField++) {
+            u8 formatIdx = dispatch[opByte][regField];
+            table[opByte][regField] =
+                (formatIdx == NO_FORMAT) ? nullptr : formatDecoders[formatIdx];
+        }
+    }
+    return table;
+}
+
+const InstFormats::DecoderTable InstFormats::decoderTable =
+    BuildDecoderTable(std::make_index_sequence<NUM_FORMATS>());
@@ -0,0 +1,89 @@
+#pragma once
+// the instruction formats and the tables built from them at compile time,
+// internal to dis86_core. InstStream decodes through these.
+#include <dis86_num_types.h>
+#include <dis86_instruction.h>
+#include <dis86_instruction_stream.h>
+
+#include <array>
+#include <utility>
+
+#define MAX_FIELD_NUM 16
+#define NUM_FORMATS 113
+
+enum BitsUsage : u8{
+    Opcode,
+    Reg,
+    SR,
+    Mod,
+    RegMem,
+    Direction,
+    Width,
+    IsShiftCL,
+    SignExt,
+    Disp,
+    Data,
+
+    HasDisp,
+    HasData,
+    WDataIfW,
+    RMIsW,
+    RelSize,   // bytes of jump displacement following the instruction
+    HasFarPtr, // followed by a 4 byte offset:segment
+    NumElements,
+};
+
+struct BitField {
+    BitsUsage name = Opcode;
+    u8 numBits = 0;
+    u8 val = 0;
+};
+
+struct InstructionFormat {
+    OpType op;
+    std::array<BitField, MAX_FIELD_NUM> fields;
+};
+
+class InstFormats {
+public:
+    // true if some instruction starts with byte, or it is a rep prefix.
+    // only the first byte is looked at, a group opcode like 0xff counts
+    // even though some of its reg fields don't decode.
+    static bool CanStartInstruction(u8 byte);
+    // true if every instruction starting with byte is that byte alone, e.g.
+    // push bp or inc ax. false for prefixes and bytes that don't decode.
+    static inline bool IsOneByteInstruction(u8 byte) { return oneByteInstructions[byte]; }
+    // what the format at formatIdx decodes to, for reporting per format
+    static OpType GetFormatOpType(u32 formatIdx);
+
+    static const u8 NO_FORMAT = 0xff;
+
+    static const std::array<InstructionFormat, NUM_FORMATS> formats;
+
+    // literal bits each format expects in the first two bytes of an
+    // instruction, the first byte in the high half. only used to build the
+    // dispatch table, the linear interpreter doesn't rely on them.
+    struct FormatLiterals {
+        u16 mask;
+        u16 val;
+    };
+
+    // index into formats for each first byte and reg field (bits 5-3) of the
+    // second byte, group opcodes like 0x80 or 0xf6 are resolved by the reg field
+    typedef std::array<std::array<u8, 8>, 256> DispatchTable;
+    static const DispatchTable dispatchTable;
+
+    // decoders generated at compile time from formats, laid out like dispatchTable
+    typedef Instruction (InstStream::*DecodeFn)();
+    typedef std::array<std::array<DecodeFn, 8>, 256> DecoderTable;
+    static const DecoderTable decoderTable;
+
+private:
+    static const std::array<bool, 256> oneByteInstructions;
+
+    static constexpr std::array<FormatLiterals, NUM_FORMATS> BuildFormatLiterals();
+    static constexpr DispatchTable BuildDispatchTable();
+    static constexpr std::array<bool, 256> BuildOneByteInstructions();
+    template<size_t... FormatIdxs>
+    static constexpr DecoderTable BuildDecoderTable(std::index_sequence<FormatIdxs...>);
+};
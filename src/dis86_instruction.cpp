@@ -1,10 +1,13 @@
 #include <dis86_num_types.h>
 #include <dis86_instruction.h>
+#include <dis86_inst_file.h>
+#include <dis86_stats.h>
 #include <iostream>
 #include <fstream>
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 #include <algorithm>
 
 #define MAX_FIELD_NUM 16
@@ -15,8 +18,8 @@ bool contains(C&& c, T e) {
     return std::find(std::begin(c), std::end(c), e) != std::end(c);
 };
 
-bool Instruction::NeedSize(OperandType type) {
-    static const std::array<OpType, 16> needSizeOptypes = {{
+bool Instruction::NeedSize(OperandType type) const {
+    static const std::array<OpType, 18> needSizeOptypes = {{
         OpType::PUSH,
         OpType::POP,
         OpType::INC,
@@ -33,42 +36,122 @@ bool Instruction::NeedSize(OperandType type) {
         OpType::ROR,
         OpType::RCL,
         OpType::RCR,
+        OpType::JMP,
+        OpType::CALL,
     }};
     
     return ((type == OperandType::MEMORY) &&
         contains(needSizeOptypes, opType));
 }
 
-Instruction::Instruction(OpType type, Operand op1, Operand op2) : opType(type), operands{op1, op2} {}
+Instruction::Instruction(OpType type, Operand op1, Operand op2)
+    : opType(type), length(0), prefix(RepPrefix::NONE), operands{op1, op2}, offset(0) {}
 
-Instruction::Instruction() : opType{}, operands{} {}
+Instruction::Instruction()
+    : opType{}, length(0), prefix(RepPrefix::NONE), operands{}, offset(0) {}
 
-void Instruction::Print(){
+static char *FormatPrefix(char *out, OpType opType, RepPrefix prefix) {
+    switch (prefix) {
+        case RepPrefix::NONE:
+            return out;
+        case RepPrefix::REP: {
+            bool isCompare = (opType == OpType::CMPSB || opType == OpType::CMPSW ||
+                              opType == OpType::SCASB || opType == OpType::SCASW);
+            std::memcpy(out, isCompare ? "repe " : "rep ", isCompare ? 5 : 4);
+            return out + (isCompare ? 5 : 4);
+        }
+        case RepPrefix::REPNE:
+            std::memcpy(out, "repne ", 6);
+            return out + 6;
+    }
+    return out;
+}
+
+char *Instruction::Format(char *out) const {
+    STATS(StatsTimer timer(StatsPhase::FORMAT));
+    STATS(GetThreadStats().numFormatted++);
     assert(opType != OpType::NONE && opType < OpType::NUM_OPS);
+    assert(opStrs[(u8)opType] != "");
+
+    out = FormatPrefix(out, opType, prefix);
+    std::string_view opStr = opStrs[(u8)opType];
+    std::memcpy(out, opStr.data(), opStr.size());
+    out += opStr.size();
+    *out++ = ' ';
+
+    if (operands[0].operandType == OperandType::RELATIVE) {
+        // nasm's $ is the start of the instruction, the displacement is
+        // from its end
+        *out++ = '$';
+        i32 fromStart = operands[0].immediate.immI16 + length;
+        if (fromStart >= 0) {
+            *out++ = '+';
+        }
+        return FormatInt(out, fromStart);
+    }
 
-    std::string operandStrs[2];
     for (u32 i = 0; i < 2; i++) {
+        if (i == 1 && operands[1].operandType != OperandType::NONE &&
+            operands[0].operandType != OperandType::NONE) {
+            *out++ = ',';
+            *out++ = ' ';
+        }
         if (NeedSize(operands[i].operandType)) {
             // NOTE: for some reason nasm requires a size to be specified
             // on instructions like push and pop even though they can
             // only operate on words.
-            std::string sizeStr = operands[i].address.isWide ? "word " : "byte ";
-            operandStrs[i] = sizeStr + operands[i].GetStr();
-        } else {
-            operandStrs[i] = operands[i].GetStr();
+            std::memcpy(out, operands[i].address.isWide ? "word " : "byte ", 5);
+            out += 5;
         }
+        out = operands[i].Format(out);
     }
+    return out;
+}
 
-    u32 numOps = (operands[0].operandType != OperandType::NONE)
-        + (operands[1].operandType != OperandType::NONE);
-    std::string sep = numOps == 2 ? ", " : "";
-    
-    assert(opStrs[(u8)opType] != "");
-    std::string instStr = opStrs[(u8)opType] + " "
-        + operandStrs[0] + sep + operandStrs[1];
+char *Instruction::FormatBranch(char *out, u32 labelIdx) const {
+    assert(operands[0].operandType == OperandType::RELATIVE);
+    std::string_view opStr = opStrs[(u8)opType];
+    std::memcpy(out, opStr.data(), opStr.size());
+    out += opStr.size();
+    std::memcpy(out, " label_", 7);
+    return FormatInt(out + 7, labelIdx);
+}
 
-    std::cout << instStr << std::endl;
-    return;
+void Instruction::Format(OutputBuffer& out) const {
+    char *line = out.Reserve(MAX_INST_STR_LEN + 1);
+    line = Format(line);
+    *line++ = '\n';
+    out.Commit(line);
+}
+
+void Instruction::FormatListing(OutputBuffer& out, const u8 *bytes) const {
+    static const char hexDigits[] = "0123456789abcdef";
+    assert(length <= MAX_INST_BYTES);
+
+    char *line = out.Reserve(MAX_LISTING_PREFIX_LEN + MAX_INST_STR_LEN + 1);
+    line = FormatOffset(line, offset);
+    *line++ = ' ';
+
+    // bytes column is wide enough for the longest instruction
+    for (u32 i = 0; i < MAX_INST_BYTES; i++) {
+        line[0] = ' ';
+        line[1] = (i < length) ? hexDigits[bytes[i] >> 4] : ' ';
+        line[2] = (i < length) ? hexDigits[bytes[i] & 0xf] : ' ';
+        line += 3;
+    }
+    *line++ = ' ';
+    *line++ = ' ';
+
+    line = Format(line);
+    *line++ = '\n';
+    out.Commit(line);
+}
+
+void Instruction::Print(){
+    char line[MAX_INST_STR_LEN + 1];
+    char *end = Format(line);
+    *end++ = '\n';
+    std::cout.write(line, end - line);
 }
 
 
@@ -78,14 +161,91 @@ Instruction::operator bool() const {
 
 // used for comparing instructions for testing
 bool Instruction::operator==(const Instruction& rhs) const{
-    return opType == rhs.opType &&
+    return opType == rhs.opType && prefix == rhs.prefix &&
            operands[0] == rhs.operands[0] &&
            operands[1] == rhs.operands[1];
 }
 
-const std::array<std::string, (u8)OpType::NUM_OPS> Instruction::opStrs = {{
+OpType Instruction::GetOpType() const {
+    return opType;
+}
+
+const Operand& Instruction::GetOperand(u32 idx) const {
+    assert(idx < 2);
+    return operands[idx];
+}
+
+std::string_view Instruction::GetOpStr() const {
+    return opStrs[(u8)opType];
+}
+
+void Instruction::Format(OutputBuffer& out, OutputFormat format, const u8 *bytes) const {
+    switch (format) {
+        case OutputFormat::TEXT:
+            Format(out);
+            break;
+        case OutputFormat::LISTING:
+            FormatListing(out, bytes);
+            break;
+        case OutputFormat::BINARY:
+            WriteInstRecord(out, *this);
+            break;
+    }
+}
+
+u64 Instruction::GetOffset() const {
+    return offset;
+}
+
+u8 Instruction::GetLength() const {
+    return length;
+}
+
+void Instruction::SetLocation(u64 offset, u8 length) {
+    this->offset = offset;
+    this->length = length;
+}
+
+RepPrefix Instruction::GetPrefix() const {
+    return prefix;
+}
+
+void Instruction::SetPrefix(RepPrefix prefix) {
+    this->prefix = prefix;
+}
+
+bool Instruction::GetBranchTarget(i64& target) const {
+    if (operands[0].operandType != OperandType::RELATIVE) {
+        return false;
+    }
+    target = (i64)offset + length + operands[0].immediate.immI16;
+    return true;
+}
+
+bool Instruction::IsControlFlow() const {
+    return (opType >= OpType::JO && opType <= OpType::RETF) || opType == OpType::IRET;
+}
+
+bool Instruction::FallsThrough() const {
+    switch (opType) {
+        case OpType::JMP:
+        case OpType::JMP_FAR:
+        case OpType::RET:
+        case OpType::RETF:
+        case OpType::IRET:
+            return false;
+        default:
+            return true;
+    }
+}
+
+const std::array<std::string_view, (u8)OpType::NUM_OPS> Instruction::opStrs = {{
     "", "add", "sub", "cmp", "mov", "adc", "sbb", "push", "pop", "xchg", "in", "out",
     "xlat", "lea", "lds", "les", "lahf", "sahf", "pushf", "popf", "or", "and", "xor",
     "inc", "aaa", "daa", "dec", "neg", "aas", "das", "mul", "imul", "aam", "div",
     "idiv", "aad", "cbw", "cwd", "not", "shl", "shr", "sar", "rol", "ror", "rcl", "rcr",
+    "jo", "jno", "jb", "jnb", "je", "jne", "jbe", "ja", "js", "jns", "jp", "jnp", "jl",
+    "jnl", "jle", "jg", "loopnz", "loopz", "loop", "jcxz", "jmp", "call", "jmp far",
+    "call far", "ret", "retf", "int", "int3", "into", "iret", "movsb", "movsw", "cmpsb",
+    "cmpsw", "stosb", "stosw", "lodsb", "lodsw", "scasb", "scasw",
 }};
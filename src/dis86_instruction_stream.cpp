@@ -3,8 +3,13 @@
 #include <iostream>
 #include <dis86_instruction.h>
 #include <dis86_instruction_stream.h>
+#include <dis86_inst_format.h>
+#include <dis86_decode_cache.h>
+#include <dis86_stats.h>
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstring>
 
 #define MAX_FIELD_NUM 16
 #define DIRECT_ADDRESS_IDX 8
@@ -24,38 +29,163 @@ inline Operand InstStream::GetSegRegOperand(u8 regVal) {
     return res;
 }
 
-InstStream::InstStream(std::istream *binFile) {
-    binFile->read((char *)bytes, ARR_SIZE(bytes));
-    size = binFile->gcount();
-    currentInstPointer = 0;
-    readPointer = 0;
+InstStream::InstStream(std::istream *binFile, u32 bufferSize)
+    : InstStream(new StreamSource(binFile, bufferSize)) {
+    ownedSource.reset(source);
 }
 
-u8 InstStream::NextByte() {
-    assert(readPointer < size);
-    return bytes[readPointer++];
+InstStream::InstStream(ByteSpan bytes, u64 startOffset) : InstStream(new MemorySource(bytes)) {
+    ownedSource.reset(source);
+    memorySource = (MemorySource *)source;
+    offset = startOffset;
+}
+
+InstStream::InstStream(ByteSource *source)
+    : source(source), memorySource(nullptr), decodeCache(nullptr), tail{} {
+    inputEnded = false;
+    failed = false;
+    counters = {};
+    offset = 0;
+    lastInstLength = 0;
+    blockEnd = tail;
+    currentInstPointer = tail;
+    readPointer = tail;
+}
+
+void InstStream::Restart(ByteSpan bytes, u64 startOffset) {
+    assert(memorySource && "only streams made from a ByteSpan can restart");
+    memorySource->Reset(bytes);
+    inputEnded = false;
+    failed = false;
+    offset = startOffset;
+    lastInstLength = 0;
+    blockEnd = tail;
+    currentInstPointer = tail;
+    readPointer = tail;
+}
+
+void InstStream::Refill() {
+    assert(readPointer == currentInstPointer);
+    ByteSpan block;
+    if (!source->Refill(block, (u32)(blockEnd - readPointer))) {
+        inputEnded = true;
+        return;
+    }
+    blockEnd = block.data + block.size;
+    currentInstPointer = block.data;
+    readPointer = block.data;
+}
+
+bool InstStream::PrepareInstruction() {
+    while (!inputEnded && blockEnd - readPointer < MAX_INST_BYTES) {
+        Refill();
+    }
+    if (readPointer >= blockEnd) {
+        return false;
+    }
+
+    if (blockEnd - readPointer < MAX_INST_BYTES) {
+        // near the end of the input, copy what's left somewhere that can be
+        // read past without running off the end of the source's memory.
+        // readPointer may already be in tail, hence the memmove.
+        u32 remaining = (u32)(blockEnd - readPointer);
+        std::memmove(tail, readPointer, remaining);
+        std::memset(tail + remaining, 0, sizeof(tail) - remaining);
+        blockEnd = tail + remaining;
+        currentInstPointer = tail;
+        readPointer = tail;
+    }
+    return true;
+}
+
+void InstStream::SetDecodeCache(DecodeCache *cache) {
+    decodeCache = cache;
+}
+
+bool InstStream::Failed() const {
+    return failed;
+}
+
+const DecodeCounters& InstStream::GetDecodeCounters() const {
+    return counters;
+}
+
+void InstStream::ResetDecodeCounters() {
+    counters = {};
+}
+
+u64 InstStream::GetOffset() const {
+    return offset;
+}
+
+const u8 *InstStream::GetInstBytes() const {
+    // the last instruction ends where the next one starts
+    return currentInstPointer - lastInstLength;
+}
+
+static inline u16 LoadU16(const u8 *bytes) {
+    u16 value;
+    std::memcpy(&value, bytes, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = (u16)((value >> 8) | (value << 8));
+#endif
+    return value;
 }
 
 u16 InstStream::ParseData(bool isWide, bool isSignExt) {
     assert(isSignExt == 0 || isSignExt == 1);
     assert(isWide == 0 || isWide == 1);
+    // always loads two bytes. an 8 bit field is never the last byte of a
+    // MAX_INST_BYTES instruction, so the second one is still readable.
+    assert(readPointer + 2 <= currentInstPointer + MAX_INST_BYTES);
+    u16 value = LoadU16(readPointer);
+    readPointer += 1 + isWide;
     if (isWide) {
-        u8 byte1 = NextByte();
-        u8 byte2 = NextByte();
-        assert(readPointer <= size);
-        return (byte2 << 8) | byte1;
+        return value;
     }
+    return isSignExt ? (u16)(i16)(i8)value : (u8)value;
+}
 
-    assert(readPointer <= size);
-    // perform sign extension
-    if (isSignExt)
-        return (i16)(i8)NextByte();
-    return NextByte();
+// what the mod and r/m fields of a mod r/m byte say about the r/m operand
+struct ModRMInfo {
+    OperandType operandType; // REGISTER or MEMORY
+    AddressExpIdx expIdx;
+    u8 dispSize;             // bytes of displacement after the mod r/m byte
+    bool dispIsSignExt;      // 8 bit displacements are sign extended
+};
+
+static constexpr std::array<ModRMInfo, 256> BuildModRMTable() {
+    std::array<ModRMInfo, 256> table = {};
+    for (u32 modRM = 0; modRM < 256; modRM++) {
+        u8 modVal = modRM >> 6;
+        u8 regMemVal = modRM & 0b111;
+        ModRMInfo& info = table[modRM];
+        if (modVal == 0b11) {
+            info.operandType = OperandType::REGISTER;
+            continue;
+        }
+        info.operandType = OperandType::MEMORY;
+        if (modVal == 0b00 && regMemVal == 0b110) {
+            info.expIdx = AddressExpIdx::DIRECT;
+            info.dispSize = 2;
+        } else {
+            info.expIdx = (AddressExpIdx)regMemVal;
+            info.dispSize = modVal;
+            info.dispIsSignExt = modVal == 0b01;
+        }
+    }
+    return table;
 }
 
-void InstStream::GetBitFields(u32 &bitFieldFlags,
+// indexed by the whole mod r/m byte, the reg field doesn't matter
+static constexpr std::array<ModRMInfo, 256> modRMTable = BuildModRMTable();
+
+// reads the fields out of bytes without moving the stream and returns
+// how many bytes they take, 0 if the opcode bits don't match
+static u32 GetBitFields(const u8 *bytes, u32 &bitFieldFlags,
     std::array<u32, BitsUsage::NumElements>& bitFieldValues,
     const std::array<BitField, MAX_FIELD_NUM>& fields) {
+    u32 numBytes = 0;
     u8 bitsRemaining = 0;
     u8 currentByte = 0;
     for (BitField testField : fields) {
@@ -68,7 +198,7 @@ void InstStream::GetBitFields(u32 &bitFieldFlags,
         if (testField.numBits != 0) {
             if (bitsRemaining == 0) {
                 bitsRemaining = 8;
-                currentByte = NextByte();
+                currentByte = bytes[numBytes++];
             }
 
             assert(testField.numBits <= bitsRemaining);
@@ -84,28 +214,30 @@ void InstStream::GetBitFields(u32 &bitFieldFlags,
         if (testField.name == BitsUsage::Opcode && testField.val != readVal) {
             // opcode does not match
             bitFieldFlags = 0;
-            readPointer = currentInstPointer;
-            return;
+            return 0;
         } else {
             bitFieldValues[(u8)testField.name] = readVal;
             bitFieldFlags |= (1 << (u8)testField.name);
         }
     }
+    return numBytes;
 }
 
-Instruction InstStream::TryDecode(const InstructionFormat format) {
+Instruction InstStream::TryDecode(const InstructionFormat& format) {
     u32 bitFieldFlags = 0;
     std::array<u32, BitsUsage::NumElements> bitFieldValues = {};
 
-    // TODO: this can be refactored into a class with all required instruction info
-    // InstructionInfo::GetBitFields
-    GetBitFields(bitFieldFlags, bitFieldValues, format.fields);
-
-    if (bitFieldFlags == 0) {
+    u32 numBytes = GetBitFields(readPointer, bitFieldFlags, bitFieldValues, format.fields);
+    if (numBytes == 0) {
         // instruction did not match given format
         return {};
     }
+    counters.numAttempts++;
+    readPointer += numBytes;
+    return BuildInstruction(format.op, bitFieldFlags, bitFieldValues.data());
+}
 
+Instruction InstStream::BuildInstruction(OpType op, u32 bitFieldFlags, u32 *bitFieldValues) {
     u32 modVal = bitFieldValues[BitsUsage::Mod];
     u32 dirVal = bitFieldValues[BitsUsage::Direction];
     u32 widthVal = bitFieldValues[BitsUsage::Width];
@@ -114,20 +246,34 @@ Instruction InstStream::TryDecode(const InstructionFormat format) {
     u32 segRegVal = bitFieldValues[BitsUsage::SR];
     u32 regMemVal = bitFieldValues[BitsUsage::RegMem];
 
-    bool hasDirectAddress = ((modVal == 0b00 && regMemVal == 0b110));
-    bool hasDisp = (modVal == 0b01 || modVal == 0b10 || hasDirectAddress);
-    bool dispIsW = (modVal == 0b10 || hasDirectAddress);
+    // formats without mod r/m fields look up entry 0, which has no
+    // displacement and is never used as an operand
+    const ModRMInfo& modRM = modRMTable[(modVal << 6) | regMemVal];
     bool hasData = bitFieldValues[BitsUsage::HasData];
     bool dataIsW = (bitFieldValues[BitsUsage::WDataIfW] && widthVal && !signVal);
     bool rmAlwaysW = bitFieldValues[BitsUsage::RMIsW];
+    u32 relSize = bitFieldValues[BitsUsage::RelSize];
 
-    if (hasDisp)
-        bitFieldValues[BitsUsage::Disp] = ParseData(dispIsW, true);
+    if (relSize) {
+        Operand target = {};
+        target.operandType = OperandType::RELATIVE;
+        target.immediate.immU16 = ParseData(relSize == 2, true);
+        target.immediate.isWide = (relSize == 2);
+        return Instruction(op, target, {});
+    }
+    if (bitFieldValues[BitsUsage::HasFarPtr]) {
+        u16 farOffset = ParseData(true, false);
+        u16 farSegment = ParseData(true, false);
+        return Instruction(op, Operand::MakeFarPointer(farSegment, farOffset), {});
+    }
+
+    if (modRM.dispSize)
+        bitFieldValues[BitsUsage::Disp] = ParseData(modRM.dispSize == 2, modRM.dispIsSignExt);
     if (hasData)
         bitFieldValues[BitsUsage::Data] = ParseData(dataIsW, signVal);
-    
+
     i16 disp = bitFieldValues[BitsUsage::Disp];
-    
+
     Operand operands[2] = {};
     Operand *regOperand = &operands[dirVal ? 0 : 1];
     Operand *modOperand = &operands[dirVal ? 1 : 0];
@@ -139,15 +285,11 @@ Instruction InstStream::TryDecode(const InstructionFormat format) {
     }
 
     if (bitFieldFlags & (1 << BitsUsage::RegMem)) {
-        if (modVal == 0b11) {
+        if (modRM.operandType == OperandType::REGISTER) {
             *modOperand = GetRegOperand(regMemVal, widthVal || rmAlwaysW);
         } else {
             modOperand->operandType = OperandType::MEMORY;
-            if (hasDirectAddress) {
-                modOperand->address.expIdx = AddressExpIdx::DIRECT;
-            } else {
-                modOperand->address.expIdx = (AddressExpIdx)regMemVal;
-            }
+            modOperand->address.expIdx = modRM.expIdx;
             modOperand->address.disp = disp;
             modOperand->address.isWide = widthVal;
         }
@@ -157,7 +299,7 @@ Instruction InstStream::TryDecode(const InstructionFormat format) {
         &operands[0] : &operands[1];
     if (nextUnusedOp->operandType != OperandType::NONE) {
         // both operands have been filled, return instruction
-        return Instruction(format.op, operands[0], operands[1]);
+        return Instruction(op, operands[0], operands[1]);
     }
 
     if (hasData) {
@@ -177,20 +319,126 @@ Instruction InstStream::TryDecode(const InstructionFormat format) {
         }
     }
 
-    return Instruction(format.op, operands[0], operands[1]);
+    return Instruction(op, operands[0], operands[1]);
+}
+
+static bool IsStringOp(u8 opByte) {
+    // movs cmps (a4 - a7) and stos lods scas (aa - af)
+    return (opByte & 0b11111100) == 0b10100100 ||
+           (opByte >= 0b10101010 && opByte <= 0b10101111);
+}
+
+RepPrefix InstStream::ReadPrefix() {
+    u8 opByte = readPointer[0];
+    if ((opByte & 0b11111110) != 0b11110010 || !IsStringOp(readPointer[1])) {
+        return RepPrefix::NONE;
+    }
+    // step over the prefix so the decoders see the opcode as the start of
+    // the instruction, CommitInstruction adds it back to the length
+    readPointer++;
+    currentInstPointer++;
+    return (opByte & 1) ? RepPrefix::REP : RepPrefix::REPNE;
+}
+
+void InstStream::CommitInstruction(Instruction& inst, RepPrefix prefix) {
+    u8 prefixLength = (prefix != RepPrefix::NONE) ? 1 : 0;
+    lastInstLength = (u8)(readPointer - currentInstPointer) + prefixLength;
+    inst.SetLocation(offset, lastInstLength);
+    inst.SetPrefix(prefix);
+    offset += lastInstLength;
+    currentInstPointer = readPointer;
+}
+
+// the parameters are only read when stats are counted
+inline void InstStream::CountProbe([[maybe_unused]] u32 formatIdx) {
+    counters.numProbes++;
+    STATS(GetThreadStats().formatAttempts[formatIdx]++);
+}
+
+// a format only counts as matched once its instruction is returned, not
+// when it turns out to be cut off by the end of the input
+inline void InstStream::CountInstruction([[maybe_unused]] u32 formatIdx,
+                                         [[maybe_unused]] u64 startTicks,
+                                         [[maybe_unused]] u64 decodeTicks) {
+    counters.numInsts++;
+    STATS(if (formatIdx != InstFormats::NO_FORMAT) { GetThreadStats().formatMatches[formatIdx]++; });
+    STATS(RecordInstruction(startTicks, decodeTicks, lastInstLength));
+}
+
+void InstStream::FailInstruction(RepPrefix prefix) {
+    if (prefix != RepPrefix::NONE) {
+        currentInstPointer--;
+    }
+    readPointer = currentInstPointer;
+    failed = true;
 }
 
 Instruction InstStream::NextInstruction() {
-    if (readPointer >= size) {
+    u64 startTicks = ReadStatsTicks();
+    if (failed || !PrepareInstruction()) {
+        return {};
+    }
+    u64 decodeTicks = ReadStatsTicks();
+    if (decodeCache) {
+        const Instruction *cached = decodeCache->Find(currentInstPointer,
+                                                      blockEnd - currentInstPointer);
+        if (cached) {
+            // the cached length already counts the prefix
+            Instruction inst = *cached;
+            lastInstLength = inst.GetLength();
+            inst.SetLocation(offset, lastInstLength);
+            offset += lastInstLength;
+            currentInstPointer += lastInstLength;
+            readPointer = currentInstPointer;
+            CountInstruction(InstFormats::NO_FORMAT, startTicks, decodeTicks);
+            return inst;
+        }
+    }
+    RepPrefix prefix = ReadPrefix();
+    u8 opByte = readPointer[0];
+    u8 regField = (readPointer[1] >> 3) & 0b111;
+    InstFormats::DecodeFn decode = InstFormats::decoderTable[opByte][regField];
+    if (decode) {
+        u8 formatIdx = InstFormats::dispatchTable[opByte][regField];
+        CountProbe(formatIdx);
+        Instruction inst = (this->*decode)();
+        if (inst && readPointer <= blockEnd) {
+            CommitInstruction(inst, prefix);
+            if (decodeCache) {
+                decodeCache->Insert(GetInstBytes(), inst);
+            }
+            CountInstruction(formatIdx, startTicks, decodeTicks);
+            return inst;
+        }
+    }
+    FailInstruction(prefix);
+    return {};
+}
+
+Instruction InstStream::NextInstructionLinear() {
+    u64 startTicks = ReadStatsTicks();
+    if (failed || !PrepareInstruction()) {
         return {};
     }
-    for (const InstructionFormat& format : formats) {
-        Instruction inst = TryDecode(format);
+    u64 decodeTicks = ReadStatsTicks();
+    RepPrefix prefix = ReadPrefix();
+    // every format is matched against the input straight from its bit fields,
+    // nothing derived from the format list is used here so this stays an
+    // independent reference for the generated decoders. GetBitFields only
+    // peeks, so the stream moves once a format matches.
+    for (u32 i = 0; i < NUM_FORMATS; i++) {
+        CountProbe(i);
+        Instruction inst = TryDecode(InstFormats::formats[i]);
         if (inst) {
-            currentInstPointer = readPointer;
+            if (readPointer > blockEnd) {
+                // instruction is cut off by the end of the input
+                break;
+            }
+            CommitInstruction(inst, prefix);
+            CountInstruction(i, startTicks, decodeTicks);
             return inst;
         }
     }
-    std::cerr << "failed to decode instruction" << std::endl;
+    FailInstruction(prefix);
     return {};
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include <dis86_labels.h>
+#include <dis86_packed_instruction.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// sorted offsets of the instruction starts in insts (decoded from
+// startOffset) that are branch targets, label_N is labels[N]
+static void CollectLabels(const std::vector<PackedInstruction>& insts, u64 startOffset,
+                   std::vector<u64>& targets, std::vector<u64>& labels) {
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+    // both are in address order so one walk drops the targets that aren't
+    // the start of an instruction
+    labels.clear();
+    u64 offset = startOffset;
+    auto target = targets.begin();
+    for (const PackedInstruction& inst : insts) {
+        while (target != targets.end() && *target < offset) {
+            target++;
+        }
+        if (target == targets.end()) {
+            break;
+        }
+        if (*target == offset) {
+            labels.push_back(offset);
+        }
+        offset += inst.GetLength();
+    }
+}
+
+static void WriteLabel(OutputBuffer& out, u32 labelIdx) {
+    char *line = out.Reserve(MAX_INST_STR_LEN);
+    std::memcpy(line, "label_", 6);
+    line = FormatInt(line + 6, labelIdx);
+    *line++ = ':';
+    *line++ = '\n';
+    out.Commit(line);
+}
+
+bool DisassembleWithLabels(InstStream& instStream, OutputBuffer& out) {
+    u64 startOffset = instStream.GetOffset();
+    std::vector<PackedInstruction> insts;
+    std::vector<u64> targets;
+
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        insts.emplace_back(inst);
+        i64 target;
+        if (inst.GetBranchTarget(target) && target >= (i64)startOffset) {
+            targets.push_back(target);
+        }
+    }
+
+    std::vector<u64> labels;
+    CollectLabels(insts, startOffset, targets, labels);
+
+    u64 offset = startOffset;
+    u32 nextLabel = 0;
+    for (const PackedInstruction& packed : insts) {
+        if (nextLabel < labels.size() && labels[nextLabel] == offset) {
+            WriteLabel(out, nextLabel++);
+        }
+
+        Instruction inst = packed.Unpack(offset);
+        char *line = out.Reserve(MAX_INST_STR_LEN + 1);
+        i64 target;
+        auto label = labels.end();
+        if (inst.GetBranchTarget(target)) {
+            label = std::lower_bound(labels.begin(), labels.end(), (u64)target);
+        }
+        if (label != labels.end() && (i64)*label == target) {
+            line = inst.FormatBranch(line, (u32)(label - labels.begin()));
+        } else {
+            line = inst.Format(line);
+        }
+        *line++ = '\n';
+        out.Commit(line);
+        offset += packed.GetLength();
+    }
+    return !instStream.Failed();
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <dis86_instruction_stream.h>
+#include <dis86_output_buffer.h>
+
+// two pass disassembly that writes a label_N: line at each target of a
+// relative jmp/jcc/call/loop and uses the label as the instruction's operand.
+// the first pass decodes into 8 byte PackedInstructions and collects the
+// targets on the side, the second formats out of that array, so the input is
+// decoded once and no text is held back. targets outside the input or in the
+// middle of an instruction keep the $+N form.
+// returns false if decoding stopped on an invalid instruction, everything
+// before it is still written.
+bool DisassembleWithLabels(InstStream& instStream, OutputBuffer& out);
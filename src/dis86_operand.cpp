@@ -1,5 +1,7 @@
 #include <dis86_operand.h>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <array>
 
@@ -9,6 +11,8 @@ bool Operand::operator==(const Operand& rhs) const {
     }
 
     switch (operandType) {
+        case OperandType::NONE:
+            return true;
         case OperandType::MEMORY:
             return address.expIdx == rhs.address.expIdx &&
                    address.disp == rhs.address.disp;
@@ -25,99 +29,235 @@ bool Operand::operator==(const Operand& rhs) const {
             } else {
                 return (i8)immediate.immI16 == (i8)rhs.immediate.immI16;
             }
+        case OperandType::RELATIVE:
+            return immediate.immI16 == rhs.immediate.immI16 &&
+                   immediate.isWide == rhs.immediate.isWide;
+        case OperandType::FAR_POINTER:
+            return farPointer.segment == rhs.farPointer.segment &&
+                   farPointer.offset == rhs.farPointer.offset;
         default:
             return false;
     }
 }
 
-std::string Operand::GetMemoryOpStr() const {
+static inline char *CopyStr(char *out, std::string_view str) {
+    std::memcpy(out, str.data(), str.size());
+    return out + str.size();
+}
+
+static const char digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+char *FormatInt(char *out, i32 val) {
+    u32 absVal = val;
+    if (val < 0) {
+        *out++ = '-';
+        absVal = 0u - absVal;
+    }
+
+    u32 numDigits = 1;
+    for (u32 pow = 10; numDigits < 10 && absVal >= pow; pow *= 10) {
+        numDigits++;
+    }
+    // fill in from the last digit back
+    char *end = out + numDigits;
+    char *digit = end;
+    while (absVal >= 10) {
+        u32 pair = (absVal % 100) * 2;
+        absVal /= 100;
+        digit -= 2;
+        digit[0] = digitPairs[pair];
+        digit[1] = digitPairs[pair + 1];
+    }
+    if (digit != out) {
+        *out = '0' + absVal;
+    }
+    return end;
+}
+
+char *FormatOffset(char *out, u64 offset) {
+    static const char hexDigits[] = "0123456789abcdef";
+    u32 numDigits = (offset >> 32) ? 16 : 8;
+    for (u32 i = 0; i < numDigits; i++) {
+        *out++ = hexDigits[(offset >> (4 * (numDigits - 1 - i))) & 0xf];
+    }
+    return out;
+}
+
+char *Operand::FormatMemory(char *out) const {
     u8 expIdx = (u8)address.expIdx;
     i16 disp = address.disp;
-    assert(expIdx < 9 && disp <= 0xffff);
-    std::string dispStr = std::to_string(std::abs(disp));
-    std::string regExp = addressExps[expIdx];
-    std::string memoryExp;
+    assert(expIdx < 9);
+    out = CopyStr(out, addressExps[expIdx]);
     if (expIdx == (u8)AddressExpIdx::DIRECT) {
-        memoryExp = disp < 0 ? "[-" + dispStr + "]" : "[" + dispStr + "]";
-    } else if (disp == 0) {
-        memoryExp =  "[" + regExp + "]";
-    } else {
-        std::string signStr = " + ";
-        if (disp < 0) {
-            signStr[1] = '-';
-        }
-        memoryExp =  "[" + regExp + signStr + dispStr + "]";
+        out = FormatInt(out, disp);
+    } else if (disp != 0) {
+        out = CopyStr(out, disp < 0 ? " - " : " + ");
+        out = FormatInt(out, std::abs((i32)disp));
     }
-
-    return memoryExp;
+    *out++ = ']';
+    return out;
 }
 
-std::string Operand::GetStr() const {
+char *Operand::Format(char *out) const {
     switch (operandType) {
         case OperandType::NONE: {
-            return "";
+            return out;
         }
         case OperandType::REGISTER: {
             u8 regIdx = (u8)reg.regIdx;
             u8 isWide = reg.isWide;
             assert(regIdx < 8 && isWide < 2);
-            return registers[regIdx][isWide];
+            return CopyStr(out, registers[regIdx][isWide]);
         }
         case OperandType::SEG_REG: {
             u8 sRegIdx = (u8)reg.sRegIdx;
             assert(sRegIdx < 4);
-            return segRegisters[sRegIdx];
+            return CopyStr(out, segRegisters[sRegIdx]);
         }
         case OperandType::IMMEDIATE: {
-            // if the immediate is a byte then truncate it first
-            i16 imm = immediate.immI16;
-            if (!immediate.isWide) {
-                imm = (i8)imm;
-            }
             // TODO: currently word/byte appears before immediates no matter what
             // this causes a bug for shift instructions. when the output of the
             // disassembler gets fed back into nasm, nasm will read 'byte'/'word' and
             // assume the encoding should be shr rm16, imm8 rather than shr rm16, 1.
             // goal: refactor so that byte/word appear only when needed
-            return (immediate.isWide ? "word " : "byte ")  + std::to_string(immediate.immI16);
+            static constexpr std::string_view sizeStrs[2] = {"byte ", "word "};
+            out = CopyStr(out, sizeStrs[immediate.isWide ? 1 : 0]);
+            return FormatInt(out, immediate.immI16);
         }
         case OperandType::MEMORY: {
-            return this->GetMemoryOpStr();
+            return FormatMemory(out);
+        }
+        case OperandType::RELATIVE: {
+            // nasm wants the target relative to the start of the instruction,
+            // which only the instruction knows, see Instruction::Format
+            return FormatInt(out, immediate.immI16);
+        }
+        case OperandType::FAR_POINTER: {
+            out = FormatInt(out, farPointer.segment);
+            *out++ = ':';
+            return FormatInt(out, farPointer.offset);
         }
         default: {
             std::cerr << "unsupposed operand type found" << std::to_string((u8)operandType) << std::endl;
-            return "";
+            return out;
         }
     }
 }
 
+std::string Operand::GetStr() const {
+    char str[MAX_OPERAND_STR_LEN];
+    return std::string(str, Format(str));
+}
+
+u8 Operand::GetIndex() const {
+    switch (operandType) {
+        case OperandType::REGISTER: return (u8)reg.regIdx;
+        case OperandType::SEG_REG: return (u8)reg.sRegIdx;
+        case OperandType::MEMORY: return (u8)address.expIdx;
+        default: return 0;
+    }
+}
+
+bool Operand::IsWide() const {
+    switch (operandType) {
+        case OperandType::REGISTER: return reg.isWide;
+        case OperandType::MEMORY: return address.isWide;
+        case OperandType::IMMEDIATE:
+        case OperandType::RELATIVE: return immediate.isWide;
+        default: return false;
+    }
+}
+
+u16 Operand::GetValue() const {
+    switch (operandType) {
+        case OperandType::MEMORY: return (u16)address.disp;
+        case OperandType::IMMEDIATE:
+        case OperandType::RELATIVE: return immediate.immU16;
+        case OperandType::FAR_POINTER: return farPointer.offset;
+        default: return 0;
+    }
+}
+
+Operand Operand::Make(OperandType type, u8 index, bool isWide, u16 value) {
+    Operand res = {};
+    res.operandType = type;
+    switch (type) {
+        case OperandType::REGISTER:
+            res.reg.regIdx = (RegisterIdx)index;
+            res.reg.isWide = isWide;
+            break;
+        case OperandType::SEG_REG:
+            res.reg.sRegIdx = (SegmentRegIdx)index;
+            break;
+        case OperandType::MEMORY:
+            res.address.expIdx = (AddressExpIdx)index;
+            res.address.isWide = isWide;
+            res.address.disp = (i16)value;
+            break;
+        case OperandType::IMMEDIATE:
+        case OperandType::RELATIVE:
+            res.immediate.immU16 = value;
+            res.immediate.isWide = isWide;
+            break;
+        case OperandType::FAR_POINTER:
+            res.farPointer.offset = value;
+            break;
+        default:
+            break;
+    }
+    return res;
+}
+
+Operand Operand::MakeFarPointer(u16 segment, u16 offset) {
+    Operand res = {};
+    res.operandType = OperandType::FAR_POINTER;
+    res.farPointer.segment = segment;
+    res.farPointer.offset = offset;
+    return res;
+}
+
+bool Operand::TryMake(OperandType type, u8 index, bool isWide, u16 value, u16 segment,
+                      Operand& out) {
+    switch (type) {
+        case OperandType::NONE:
+        case OperandType::IMMEDIATE:
+        case OperandType::RELATIVE:
+            break;
+        case OperandType::REGISTER:
+            if (index >= ARR_SIZE(registers)) {
+                return false;
+            }
+            break;
+        case OperandType::SEG_REG:
+            if (index >= ARR_SIZE(segRegisters)) {
+                return false;
+            }
+            break;
+        case OperandType::MEMORY:
+            if (index > (u8)AddressExpIdx::DIRECT) {
+                return false;
+            }
+            break;
+        case OperandType::FAR_POINTER:
+            out = MakeFarPointer(segment, value);
+            return true;
+        default:
+            return false;
+    }
+    out = Make(type, index, isWide, value);
+    return true;
+}
+
 std::ostream& operator<<(std::ostream s, const Operand& op) {
     return s << op.GetStr();
 }
-
-const std::string Operand::registers[8][2] = {
-    {"al", "ax"}, // 000
-    {"cl", "cx"}, // 001
-    {"dl", "dx"}, // 010
-    {"bl", "bx"}, // 011
-    {"ah", "sp"}, // 100
-    {"ch", "bp"}, // 101
-    {"dh", "si"}, // 110
-    {"bh", "di"}, // 111
-};
-
-const std::string Operand::addressExps[9] = {
-    "bx + si",
-    "bx + di",
-    "bp + si",
-    "bp + di",
-    "si",
-    "di",
-    "bp",
-    "bx",
-    "", // direct address (no expression)
-};
-
-const std::string Operand::segRegisters[] = {
-    "es", "cs", "ss", "ds",
-};
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include <dis86_output_buffer.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+OutputBuffer::OutputBuffer() : OutputBuffer(nullptr, 1024) {}
+
+OutputBuffer::OutputBuffer(std::ostream *sink, u32 capacity)
+    : ownedBlock(new char[capacity]), block(ownedBlock.get()),
+      capacity(capacity), size(0), sink(sink) {}
+
+OutputBuffer::OutputBuffer(char *block, u32 capacity, std::ostream *sink)
+    : block(block), capacity(capacity), size(0), sink(sink) {}
+
+OutputBuffer::~OutputBuffer() {
+    Flush();
+}
+
+void OutputBuffer::MakeRoom(u64 numBytes) {
+    if (sink) {
+        Flush();
+        if (numBytes <= capacity) {
+            return;
+        }
+    }
+
+    u64 newCapacity = std::max(capacity * 2, size + numBytes);
+    char *newBlock = new char[newCapacity];
+    std::memcpy(newBlock, block, size);
+    ownedBlock.reset(newBlock);
+    block = newBlock;
+    capacity = newCapacity;
+}
+
+void OutputBuffer::Write(const char *str, u64 len) {
+    char *out = Reserve(len);
+    std::memcpy(out, str, len);
+    Commit(out + len);
+}
+
+void OutputBuffer::Flush() {
+    if (sink && size) {
+        sink->write(block, size);
+        sink->flush();
+        size = 0;
+    }
+}
+
+void OutputBuffer::Clear() {
+    size = 0;
+}
+
+const char *OutputBuffer::Data() const {
+    return block;
+}
+
+u64 OutputBuffer::Size() const {
+    return size;
+}
@@ -0,0 +1,88 @@
+#include <dis86_packed_instruction.h>
+#include <dis86_instruction_stream.h>
+#include <cassert>
+
+PackedInstruction::PackedInstruction()
+    : opType(OpType::NONE), operandType0(0), operandType1(0), isWide0(0),
+      isWide1(0), index0(0), index1(0), length(0), prefix(0), values{0, 0} {}
+
+PackedInstruction::PackedInstruction(const Instruction& inst) : PackedInstruction() {
+    const Operand& op0 = inst.GetOperand(0);
+    const Operand& op1 = inst.GetOperand(1);
+    assert((u8)op0.operandType < 8 && (u8)op1.operandType < 8);
+    assert(op0.GetIndex() < 16 && op1.GetIndex() < 16);
+
+    opType = inst.GetOpType();
+    operandType0 = (u8)op0.operandType;
+    operandType1 = (u8)op1.operandType;
+    isWide0 = op0.IsWide();
+    isWide1 = op1.IsWide();
+    index0 = op0.GetIndex();
+    index1 = op1.GetIndex();
+    values[0] = op0.GetValue();
+    values[1] = op1.GetValue();
+    if (op0.operandType == OperandType::FAR_POINTER) {
+        assert(op1.operandType == OperandType::NONE);
+        values[1] = op0.farPointer.segment;
+    }
+    assert(inst.GetLength() < 16);
+    length = inst.GetLength();
+    prefix = (u8)inst.GetPrefix();
+}
+
+OpType PackedInstruction::GetOpType() const {
+    return opType;
+}
+
+OperandType PackedInstruction::GetOperandType(u32 idx) const {
+    assert(idx < 2);
+    return (OperandType)(idx == 0 ? operandType0 : operandType1);
+}
+
+Operand PackedInstruction::GetOperand(u32 idx) const {
+    assert(idx < 2);
+    if (idx == 0) {
+        if ((OperandType)operandType0 == OperandType::FAR_POINTER) {
+            return Operand::MakeFarPointer(values[1], values[0]);
+        }
+        return Operand::Make((OperandType)operandType0, index0, isWide0, values[0]);
+    }
+    return Operand::Make((OperandType)operandType1, index1, isWide1, values[1]);
+}
+
+u8 PackedInstruction::GetLength() const {
+    return length;
+}
+
+Instruction PackedInstruction::Unpack(u64 offset) const {
+    Instruction inst(opType, GetOperand(0), GetOperand(1));
+    inst.SetLocation(offset, length);
+    inst.SetPrefix((RepPrefix)prefix);
+    return inst;
+}
+
+PackedInstruction::operator bool() const {
+    return opType != OpType::NONE;
+}
+
+bool PackedInstruction::operator==(const PackedInstruction& rhs) const {
+    return opType == rhs.opType &&
+        operandType0 == rhs.operandType0 && operandType1 == rhs.operandType1 &&
+        isWide0 == rhs.isWide0 && isWide1 == rhs.isWide1 &&
+        index0 == rhs.index0 && index1 == rhs.index1 &&
+        values[0] == rhs.values[0] && values[1] == rhs.values[1] &&
+        length == rhs.length && prefix == rhs.prefix;
+}
+
+bool DecodePacked(ByteSpan bytes, std::vector<PackedInstruction>& out) {
+    out.clear();
+    // most instructions are two to four bytes
+    out.reserve(bytes.size / 3);
+
+    InstStream instStream(bytes);
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        out.emplace_back(inst);
+    }
+    return !instStream.Failed();
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <dis86_byte_source.h>
+#include <dis86_instruction.h>
+#include <vector>
+
+// an Instruction squeezed into 8 bytes for holding whole decoded images in
+// memory. Operands are stored flattened (see Operand::GetIndex/GetValue) and
+// Instruction/Operand values are rebuilt on demand.
+class PackedInstruction {
+public:
+    PackedInstruction();
+    explicit PackedInstruction(const Instruction& inst);
+
+    OpType GetOpType() const;
+    OperandType GetOperandType(u32 idx) const;
+    Operand GetOperand(u32 idx) const;
+    u8 GetLength() const;
+    // the offset isn't stored, it is the sum of the lengths before this
+    // instruction when decoding a whole image
+    Instruction Unpack(u64 offset = 0) const;
+
+    explicit operator bool() const;
+    bool operator==(const PackedInstruction& rhs) const;
+
+private:
+    OpType opType;
+    u8 operandType0 : 3;
+    u8 operandType1 : 3;
+    u8 isWide0 : 1;
+    u8 isWide1 : 1;
+    // register, segment register or address expression index
+    u8 index0 : 4;
+    u8 index1 : 4;
+    u8 length : 4;
+    u8 prefix : 2;
+    // displacement or immediate of each operand, both are needed for
+    // e.g. mov word [bx + 1000], 1234. far pointers take both.
+    u16 values[2];
+};
+
+static_assert(sizeof(PackedInstruction) == 8, "PackedInstruction must stay 8 bytes");
+
+// same as DecodeBatch but one 8 byte PackedInstruction per instruction
+bool DecodePacked(ByteSpan bytes, std::vector<PackedInstruction>& out);
@@ -0,0 +1,115 @@
+#include <dis86_parallel.h>
+#include <dis86_instruction_stream.h>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+struct DecodedChunk {
+    // offset of each decoded instruction and where its line ends in text
+    std::vector<u64> instOffsets;
+    std::vector<u64> lineEnds;
+    OutputBuffer text;
+    // offset just past the last decoded instruction
+    u64 endOffset = 0;
+    // decoding stopped at endOffset on an invalid instruction
+    bool failed = false;
+};
+
+// decodes every instruction starting in [start, end), the last one may run past end
+static void DecodeChunk(ByteSpan image, u64 start, u64 end, OutputFormat format,
+                        DecodedChunk& chunk) {
+    chunk.instOffsets.clear();
+    chunk.lineEnds.clear();
+    chunk.text.Clear();
+
+    InstStream instStream(ByteSpan{image.data + start, image.size - start}, start);
+    Instruction inst;
+    while (instStream.GetOffset() < end && (inst = instStream.NextInstruction())) {
+        chunk.instOffsets.push_back(inst.GetOffset());
+        inst.Format(chunk.text, format, instStream.GetInstBytes());
+        chunk.lineEnds.push_back(chunk.text.Size());
+    }
+    chunk.endOffset = instStream.GetOffset();
+    chunk.failed = instStream.Failed();
+}
+
+// appends chunk's output to out, given that the true decode has reached
+// trueOffset (somewhere at the start of the chunk). returns false if the
+// true decode failed, otherwise trueOffset is moved to the end of the chunk.
+static bool StitchChunk(ByteSpan image, u64 chunkEnd, const DecodedChunk& chunk,
+                        OutputFormat format, u64& trueOffset, OutputBuffer& out) {
+    const std::vector<u64>& offsets = chunk.instOffsets;
+    auto sync = std::lower_bound(offsets.begin(), offsets.end(), trueOffset);
+
+    if (sync == offsets.end() || *sync != trueOffset) {
+        // the speculative decode started mid-instruction, decode again from
+        // the true boundary until both agree on where an instruction starts
+        InstStream instStream(ByteSpan{image.data + trueOffset, image.size - trueOffset},
+                              trueOffset);
+        while (true) {
+            sync = std::lower_bound(sync, offsets.end(), trueOffset);
+            if (sync != offsets.end() && *sync == trueOffset) {
+                break;
+            }
+            if (trueOffset >= chunkEnd) {
+                return true;
+            }
+            Instruction inst = instStream.NextInstruction();
+            if (!inst) {
+                return !instStream.Failed();
+            }
+            inst.Format(out, format, instStream.GetInstBytes());
+            trueOffset = instStream.GetOffset();
+        }
+    }
+
+    size_t syncIdx = sync - offsets.begin();
+    u64 textStart = (syncIdx == 0) ? 0 : chunk.lineEnds[syncIdx - 1];
+    out.Write(chunk.text.Data() + textStart, chunk.text.Size() - textStart);
+    trueOffset = chunk.endOffset;
+    return !chunk.failed;
+}
+
+bool DisassembleParallel(ByteSpan image, u32 numThreads, OutputBuffer& out, u32 chunkSize,
+                         OutputFormat format) {
+    numThreads = std::max<u32>(numThreads, 1);
+    chunkSize = std::max<u32>(chunkSize, MAX_INST_BYTES);
+    u64 numChunks = (image.size + chunkSize - 1) / chunkSize;
+
+    // chunks are handled numThreads at a time so only that many chunks of
+    // text are held in memory before being written out
+    std::vector<DecodedChunk> chunks(numThreads);
+    std::vector<std::thread> workers;
+    u64 trueOffset = 0;
+
+    for (u64 firstChunk = 0; firstChunk < numChunks; firstChunk += numThreads) {
+        u32 roundChunks = (u32)std::min<u64>(numThreads, numChunks - firstChunk);
+        for (u32 i = 0; i < roundChunks; i++) {
+            u64 start = (firstChunk + i) * chunkSize;
+            u64 end = std::min<u64>(start + chunkSize, image.size);
+            // the first chunk of the round starts where the true decode is
+            // so it never needs stitching
+            if (i == 0) {
+                start = trueOffset;
+            }
+            workers.emplace_back(DecodeChunk, image, start, end, format, std::ref(chunks[i]));
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+
+        for (u32 i = 0; i < roundChunks; i++) {
+            u64 chunkEnd = std::min<u64>((firstChunk + i + 1) * chunkSize, image.size);
+            if (trueOffset >= chunkEnd) {
+                // the previous chunk's last instruction covered this one
+                continue;
+            }
+            if (!StitchChunk(image, chunkEnd, chunks[i], format, trueOffset, out)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <dis86_byte_source.h>
+#include <dis86_output_buffer.h>
+#include <dis86_instruction.h>
+
+#define DEFAULT_PARALLEL_CHUNK_SIZE (1024 * 256)
+
+// decodes and formats image on numThreads threads. the image is cut into
+// chunks that are decoded from their (speculative) start offsets in parallel,
+// then stitched together where each chunk's decode lines up with the true
+// instruction boundaries coming out of the previous one. only the part of a
+// chunk before that point is decoded again.
+// the output is identical to decoding the image in one go. returns false if
+// decoding stopped on bytes that aren't a valid instruction.
+bool DisassembleParallel(ByteSpan image, u32 numThreads, OutputBuffer& out,
+                         u32 chunkSize = DEFAULT_PARALLEL_CHUNK_SIZE,
+                         OutputFormat format = OutputFormat::TEXT);
@@ -0,0 +1,328 @@
+#include <dis86_scan.h>
+#include <dis86_inst_format.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// the vector kernels use gcc/clang target attributes, so the rest of the
+// build doesn't need -mavx2 and the same binary runs on older cpus
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86
+#include <immintrin.h>
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// u32 histogram counters can't overflow within a chunk this size
+#define HISTOGRAM_CHUNK_SIZE ((u64)1 << 30)
+
+static inline u32 PopCount(u64 word) {
+#ifdef _MSC_VER
+    return (u32)__popcnt64(word);
+#else
+    return __builtin_popcountll(word);
+#endif
+}
+
+static inline u32 CountTrailingZeros(u32 mask) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return idx;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// byte classes for the valid start kernels. the vector ones treat the 256
+// possible bytes as 16 rows (high nibble) of 16 columns (low nibble): a
+// shuffle by the low nibble picks out the column, as one bit per row, and a
+// shuffle by the high nibble picks the row's bit.
+struct StartTables {
+    bool valid[256];
+    // bit h of column lo is set if byte (h << 4 | lo) can start an
+    // instruction, rows 0-7 in columnsLo and 8-15 in columnsHi
+    u8 columnsLo[16];
+    u8 columnsHi[16];
+};
+
+static StartTables BuildStartTables() {
+    StartTables tables = {};
+    for (u32 byte = 0; byte < 256; byte++) {
+        tables.valid[byte] = InstFormats::CanStartInstruction((u8)byte);
+        if (tables.valid[byte]) {
+            u32 row = byte >> 4;
+            u8 *columns = (row < 8) ? tables.columnsLo : tables.columnsHi;
+            columns[byte & 0xf] |= 1 << (row % 8);
+        }
+    }
+    return tables;
+}
+
+static const StartTables& GetStartTables() {
+    static const StartTables tables = BuildStartTables();
+    return tables;
+}
+
+// picks the bit of each row, the half that isn't the byte's row gives 0
+static const u8 rowBitsLo[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 0, 0, 0, 0, 0, 0, 0, 0 };
+static const u8 rowBitsHi[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, 128 };
+
+static void CountBytes(ByteSpan image, std::array<u64, 256>& histogram) {
+    // four sets of counters, so runs of one byte value don't each wait for
+    // the increment before
+    u32 counts[4][256];
+    histogram.fill(0);
+    const u8 *data = image.data;
+    u64 left = image.size;
+    while (left > 0) {
+        u64 chunkSize = std::min(left, HISTOGRAM_CHUNK_SIZE);
+        std::memset(counts, 0, sizeof(counts));
+        u64 i = 0;
+        for (; i + 4 <= chunkSize; i += 4) {
+            counts[0][data[i]]++;
+            counts[1][data[i + 1]]++;
+            counts[2][data[i + 2]]++;
+            counts[3][data[i + 3]]++;
+        }
+        for (; i < chunkSize; i++) {
+            counts[0][data[i]]++;
+        }
+        for (u32 byte = 0; byte < 256; byte++) {
+            histogram[byte] += (u64)counts[0][byte] + counts[1][byte] + counts[2][byte] +
+                counts[3][byte];
+        }
+        data += chunkSize;
+        left -= chunkSize;
+    }
+}
+
+// fills words from firstWord on and returns the number of bits set
+static u64 FindValidStartsScalar(ByteSpan image, u64 firstWord, u64 *words) {
+    const bool *valid = GetStartTables().valid;
+    u64 numValid = 0;
+    for (u64 wordIdx = firstWord; wordIdx * 64 < image.size; wordIdx++) {
+        const u8 *data = image.data + wordIdx * 64;
+        u32 numBytes = (u32)std::min<u64>(64, image.size - wordIdx * 64);
+        u64 word = 0;
+        for (u32 i = 0; i < numBytes; i++) {
+            word |= (u64)valid[data[i]] << i;
+        }
+        words[wordIdx] = word;
+        numValid += PopCount(word);
+    }
+    return numValid;
+}
+
+// offsets of pattern in image from start on
+static void FindPatternScalar(ByteSpan image, const std::vector<u8>& pattern, u64 start,
+                              std::vector<u64>& matches) {
+    u64 patternSize = pattern.size();
+    for (u64 i = start; i + patternSize <= image.size; i++) {
+        if (image.data[i] == pattern[0] &&
+            std::memcmp(image.data + i, pattern.data(), patternSize) == 0) {
+            matches.push_back(i);
+        }
+    }
+}
+
+// candidates are offsets where both the first and the last byte of the
+// pattern match, the bytes between are only compared for those
+static inline void CheckCandidates(ByteSpan image, const std::vector<u8>& pattern, u64 offset,
+                                   u32 candidates, std::vector<u64>& matches) {
+    u64 middleSize = pattern.size() >= 2 ? pattern.size() - 2 : 0;
+    while (candidates) {
+        u64 matchOffset = offset + CountTrailingZeros(candidates);
+        if (std::memcmp(image.data + matchOffset + 1, pattern.data() + 1, middleSize) == 0) {
+            matches.push_back(matchOffset);
+        }
+        candidates &= candidates - 1;
+    }
+}
+
+#ifdef SCAN_X86
+
+TARGET_SSSE3 static inline u32 ClassifySsse3(__m128i bytes, __m128i columnsLo, __m128i columnsHi,
+                                             __m128i bitsLo, __m128i bitsHi) {
+    __m128i nibbleMask = _mm_set1_epi8(0xf);
+    __m128i lo = _mm_and_si128(bytes, nibbleMask);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibbleMask);
+    __m128i hits = _mm_or_si128(
+        _mm_and_si128(_mm_shuffle_epi8(columnsLo, lo), _mm_shuffle_epi8(bitsLo, hi)),
+        _mm_and_si128(_mm_shuffle_epi8(columnsHi, lo), _mm_shuffle_epi8(bitsHi, hi)));
+    u32 misses = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(hits, _mm_setzero_si128()));
+    return ~misses & 0xffff;
+}
+
+TARGET_SSSE3 static u64 FindValidStartsSsse3(ByteSpan image, u64 *words) {
+    const StartTables& tables = GetStartTables();
+    __m128i columnsLo = _mm_loadu_si128((const __m128i *)tables.columnsLo);
+    __m128i columnsHi = _mm_loadu_si128((const __m128i *)tables.columnsHi);
+    __m128i bitsLo = _mm_loadu_si128((const __m128i *)rowBitsLo);
+    __m128i bitsHi = _mm_loadu_si128((const __m128i *)rowBitsHi);
+
+    u64 numValid = 0;
+    u64 wordIdx = 0;
+    for (; (wordIdx + 1) * 64 <= image.size; wordIdx++) {
+        const u8 *data = image.data + wordIdx * 64;
+        u64 word = 0;
+        for (u32 i = 0; i < 4; i++) {
+            __m128i bytes = _mm_loadu_si128((const __m128i *)(data + i * 16));
+            word |= (u64)ClassifySsse3(bytes, columnsLo, columnsHi, bitsLo, bitsHi) << (i * 16);
+        }
+        words[wordIdx] = word;
+        numValid += PopCount(word);
+    }
+    return numValid + FindValidStartsScalar(image, wordIdx, words);
+}
+
+TARGET_SSSE3 static void FindPatternSsse3(ByteSpan image, const std::vector<u8>& pattern,
+                                          std::vector<u64>& matches) {
+    u64 lastIdx = pattern.size() - 1;
+    __m128i first = _mm_set1_epi8((char)pattern[0]);
+    __m128i last = _mm_set1_epi8((char)pattern[lastIdx]);
+    u64 i = 0;
+    for (; i + lastIdx + 16 <= image.size; i += 16) {
+        __m128i firstBytes = _mm_loadu_si128((const __m128i *)(image.data + i));
+        __m128i lastBytes = _mm_loadu_si128((const __m128i *)(image.data + i + lastIdx));
+        __m128i both = _mm_and_si128(_mm_cmpeq_epi8(firstBytes, first),
+                                     _mm_cmpeq_epi8(lastBytes, last));
+        CheckCandidates(image, pattern, i, (u32)_mm_movemask_epi8(both), matches);
+    }
+    FindPatternScalar(image, pattern, i, matches);
+}
+
+TARGET_AVX2 static inline u32 ClassifyAvx2(__m256i bytes, __m256i columnsLo, __m256i columnsHi,
+                                           __m256i bitsLo, __m256i bitsHi) {
+    __m256i nibbleMask = _mm256_set1_epi8(0xf);
+    __m256i lo = _mm256_and_si256(bytes, nibbleMask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibbleMask);
+    __m256i hits = _mm256_or_si256(
+        _mm256_and_si256(_mm256_shuffle_epi8(columnsLo, lo), _mm256_shuffle_epi8(bitsLo, hi)),
+        _mm256_and_si256(_mm256_shuffle_epi8(columnsHi, lo), _mm256_shuffle_epi8(bitsHi, hi)));
+    return ~(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hits, _mm256_setzero_si256()));
+}
+
+TARGET_AVX2 static u64 FindValidStartsAvx2(ByteSpan image, u64 *words) {
+    // vpshufb looks up within each 128 bit lane, so both lanes get the table
+    const StartTables& tables = GetStartTables();
+    __m256i columnsLo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)tables.columnsLo));
+    __m256i columnsHi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)tables.columnsHi));
+    __m256i bitsLo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)rowBitsLo));
+    __m256i bitsHi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)rowBitsHi));
+
+    u64 numValid = 0;
+    u64 wordIdx = 0;
+    for (; (wordIdx + 1) * 64 <= image.size; wordIdx++) {
+        const u8 *data = image.data + wordIdx * 64;
+        __m256i low = _mm256_loadu_si256((const __m256i *)data);
+        __m256i high = _mm256_loadu_si256((const __m256i *)(data + 32));
+        u64 word = ClassifyAvx2(low, columnsLo, columnsHi, bitsLo, bitsHi) |
+            ((u64)ClassifyAvx2(high, columnsLo, columnsHi, bitsLo, bitsHi) << 32);
+        words[wordIdx] = word;
+        numValid += PopCount(word);
+    }
+    return numValid + FindValidStartsScalar(image, wordIdx, words);
+}
+
+TARGET_AVX2 static void FindPatternAvx2(ByteSpan image, const std::vector<u8>& pattern,
+                                        std::vector<u64>& matches) {
+    u64 lastIdx = pattern.size() - 1;
+    __m256i first = _mm256_set1_epi8((char)pattern[0]);
+    __m256i last = _mm256_set1_epi8((char)pattern[lastIdx]);
+    u64 i = 0;
+    for (; i + lastIdx + 32 <= image.size; i += 32) {
+        __m256i firstBytes = _mm256_loadu_si256((const __m256i *)(image.data + i));
+        __m256i lastBytes = _mm256_loadu_si256((const __m256i *)(image.data + i + lastIdx));
+        __m256i both = _mm256_and_si256(_mm256_cmpeq_epi8(firstBytes, first),
+                                        _mm256_cmpeq_epi8(lastBytes, last));
+        CheckCandidates(image, pattern, i, (u32)_mm256_movemask_epi8(both), matches);
+    }
+    FindPatternScalar(image, pattern, i, matches);
+}
+
+#endif
+
+bool IsScanIsaSupported(ScanIsa isa) {
+    switch (isa) {
+        case ScanIsa::SCALAR:
+            return true;
+#ifdef SCAN_X86
+        case ScanIsa::SSSE3:
+            return __builtin_cpu_supports("ssse3");
+        case ScanIsa::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+ScanIsa GetBestScanIsa() {
+    static const ScanIsa best = IsScanIsaSupported(ScanIsa::AVX2) ? ScanIsa::AVX2 :
+        IsScanIsaSupported(ScanIsa::SSSE3) ? ScanIsa::SSSE3 : ScanIsa::SCALAR;
+    return best;
+}
+
+const char *GetScanIsaName(ScanIsa isa) {
+    switch (isa) {
+        case ScanIsa::SSSE3:
+            return "ssse3";
+        case ScanIsa::AVX2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+void ScanImage(ByteSpan image, const std::vector<std::vector<u8>>& patterns,
+               ScanResult& result, ScanIsa isa) {
+    assert(IsScanIsaSupported(isa));
+    if (!IsScanIsaSupported(isa)) {
+        isa = ScanIsa::SCALAR;
+    }
+
+    // the histogram is a scatter, vectors don't help it
+    CountBytes(image, result.histogram);
+
+    result.validStarts.resize((image.size + 63) / 64);
+    u64 *words = result.validStarts.data();
+    switch (isa) {
+#ifdef SCAN_X86
+        case ScanIsa::SSSE3:
+            result.numValidStarts = FindValidStartsSsse3(image, words);
+            break;
+        case ScanIsa::AVX2:
+            result.numValidStarts = FindValidStartsAvx2(image, words);
+            break;
+#endif
+        default:
+            result.numValidStarts = FindValidStartsScalar(image, 0, words);
+            break;
+    }
+
+    result.matches.resize(patterns.size());
+    for (u32 i = 0; i < patterns.size(); i++) {
+        std::vector<u64>& matches = result.matches[i];
+        matches.clear();
+        if (patterns[i].empty() || patterns[i].size() > image.size) {
+            continue;
+        }
+        switch (isa) {
+#ifdef SCAN_X86
+            case ScanIsa::SSSE3:
+                FindPatternSsse3(image, patterns[i], matches);
+                break;
+            case ScanIsa::AVX2:
+                FindPatternAvx2(image, patterns[i], matches);
+                break;
+#endif
+            default:
+                FindPatternScalar(image, patterns[i], 0, matches);
+                break;
+        }
+    }
+}
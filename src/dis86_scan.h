@@ -0,0 +1,42 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <dis86_byte_source.h>
+#include <array>
+#include <vector>
+
+// instruction sets the scan kernels are built for. the x86 ones are only
+// compiled with gcc and clang and are picked at run time.
+enum class ScanIsa : u8 {
+    SCALAR,
+    SSSE3,
+    AVX2,
+};
+
+// best the running cpu supports
+ScanIsa GetBestScanIsa();
+bool IsScanIsaSupported(ScanIsa isa);
+const char *GetScanIsaName(ScanIsa isa);
+
+// quick look at an image without decoding it, to tell whether it is worth
+// disassembling and where to start
+struct ScanResult {
+    // how often each byte value appears, i.e. the first byte histogram of
+    // every possible instruction start
+    std::array<u64, 256> histogram;
+    // bit i is set if byte i can start an instruction, judged by its first
+    // byte alone (see InstFormats::CanStartInstruction)
+    std::vector<u64> validStarts;
+    u64 numValidStarts;
+    // offsets of every match of each pattern, overlapping ones included,
+    // in the order the patterns were given
+    std::vector<std::vector<u64>> matches;
+
+    inline bool IsValidStart(u64 offset) const {
+        return (validStarts[offset / 64] >> (offset % 64)) & 1;
+    }
+};
+
+// fills result, reusing its allocations. every isa gives the same result,
+// the default is the fastest one available.
+void ScanImage(ByteSpan image, const std::vector<std::vector<u8>>& patterns,
+               ScanResult& result, ScanIsa isa = GetBestScanIsa());
@@ -0,0 +1,476 @@
+#include <dis86_server.h>
+#include <dis86_endian.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// the response header, status and size
+#define RESPONSE_HEADER_BYTES 5
+// how long a worker with nothing queued waits for the next request on the
+// connection it just served, which saves handing it back to Run and
+// taking it off the queue again for a client sending one after another
+#define SERVER_LINGER_MS 1
+
+#ifdef _WIN32
+
+Server::Server(const ServerOptions& options, BatchFileFn requestFn)
+    : options(options), requestFn(requestFn), listenFd(-1), socketDevice(0), socketInode(0),
+      wakeFds{-1, -1}, stopping(false) {}
+Server::~Server() {}
+
+bool Server::Start() {
+    std::cerr << "the server needs unix domain sockets, which this build doesn't have" << std::endl;
+    return false;
+}
+
+void Server::Run() {}
+void Server::Stop() {}
+void Server::RunWorker() {}
+bool Server::ServeRequest(int, InstStream&, std::vector<u8>&, OutputBuffer&) { return false; }
+bool Server::IsNextRequestDue(int) { return false; }
+void Server::CloseConnection(int) {}
+
+Client::Client() : fd(-1) {}
+Client::~Client() {}
+bool Client::Connect(const char *) { return false; }
+bool Client::Disassemble(ByteSpan, ServerStatus&, std::string&) { return false; }
+void Client::Close() {}
+
+#else
+
+// keeps a peer that went away from killing the process with SIGPIPE
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+static void IgnoreSigPipe(int fd) {
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+    (void)fd;
+#endif
+}
+
+static bool ReadAll(int fd, u8 *data, u64 size) {
+    while (size > 0) {
+        ssize_t numRead = recv(fd, data, size, 0);
+        if (numRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (numRead <= 0) {
+            return false;
+        }
+        data += numRead;
+        size -= numRead;
+    }
+    return true;
+}
+
+// sends both buffers, one after the other, in as few calls as it can
+static bool WriteAll(int fd, const void *first, u64 firstSize, const void *second,
+                     u64 secondSize) {
+    iovec iov[2] = {
+        { (void *)first, firstSize },
+        { (void *)second, secondSize },
+    };
+    u32 iovIdx = 0;
+    while (iovIdx < 2) {
+        msghdr msg = {};
+        msg.msg_iov = iov + iovIdx;
+        msg.msg_iovlen = 2 - iovIdx;
+        ssize_t numSent = sendmsg(fd, &msg, SEND_FLAGS);
+        if (numSent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (numSent < 0) {
+            return false;
+        }
+        while (iovIdx < 2 && (u64)numSent >= iov[iovIdx].iov_len) {
+            numSent -= iov[iovIdx].iov_len;
+            iovIdx++;
+        }
+        if (iovIdx < 2) {
+            iov[iovIdx].iov_base = (u8 *)iov[iovIdx].iov_base + numSent;
+            iov[iovIdx].iov_len -= numSent;
+        }
+    }
+    return true;
+}
+
+static bool MakeAddress(const char *socketPath, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (std::strlen(socketPath) >= sizeof(address.sun_path)) {
+        std::cerr << "socket path too long: " << socketPath << std::endl;
+        return false;
+    }
+    std::strcpy(address.sun_path, socketPath);
+    return true;
+}
+
+// removes a socket file left by a server that didn't shut down cleanly.
+// false if the path is anything else or a server still accepts on it.
+static bool RemoveStaleSocket(const sockaddr_un& address) {
+    struct stat info;
+    if (lstat(address.sun_path, &info) < 0) {
+        return errno == ENOENT;
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        std::cerr << address.sun_path << " exists and is not a socket" << std::endl;
+        return false;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "could not create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    // only a refused connection means nothing is listening, a full backlog
+    // or no permission still leaves the socket with its owner
+    bool isStale = connect(fd, (const sockaddr *)&address, sizeof(address)) < 0 &&
+                   errno == ECONNREFUSED;
+    close(fd);
+    if (!isStale) {
+        std::cerr << "a server is already running on " << address.sun_path << std::endl;
+        return false;
+    }
+    if (unlink(address.sun_path) < 0 && errno != ENOENT) {
+        std::cerr << "could not remove " << address.sun_path << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// a request, or its response, that stalls for longer than timeoutMs fails
+// instead of holding its worker
+static void SetTimeouts(int fd, u32 timeoutMs) {
+    if (timeoutMs == 0) {
+        return;
+    }
+    timeval timeout = {};
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+Server::Server(const ServerOptions& options, BatchFileFn requestFn)
+    : options(options), requestFn(requestFn), listenFd(-1), socketDevice(0), socketInode(0),
+      wakeFds{-1, -1}, stopping(false) {}
+
+Server::~Server() {
+    Stop();
+    if (listenFd >= 0) {
+        close(listenFd);
+        // the path may have been replaced since Start, leave it if so
+        struct stat info;
+        if (lstat(options.socketPath, &info) == 0 && S_ISSOCK(info.st_mode) &&
+            (u64)info.st_dev == socketDevice && (u64)info.st_ino == socketInode) {
+            unlink(options.socketPath);
+        }
+    }
+    for (int fd : wakeFds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool Server::Start() {
+    sockaddr_un address;
+    if (!MakeAddress(options.socketPath, address)) {
+        return false;
+    }
+    // never blocks a worker handing a connection back
+    if (pipe(wakeFds) < 0 || fcntl(wakeFds[1], F_SETFL, O_NONBLOCK) < 0) {
+        std::cerr << "could not create pipe: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "could not create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (!RemoveStaleSocket(address)) {
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    struct stat info;
+    bool isBound = bind(listenFd, (sockaddr *)&address, sizeof(address)) == 0;
+    if (!isBound || lstat(options.socketPath, &info) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+        std::cerr << "could not listen on " << options.socketPath << ": "
+                  << std::strerror(errno) << std::endl;
+        close(listenFd);
+        listenFd = -1;
+        if (isBound) {
+            unlink(options.socketPath);
+        }
+        return false;
+    }
+    socketDevice = info.st_dev;
+    socketInode = info.st_ino;
+
+    for (u32 i = 0; i < std::max<u32>(options.numWorkers, 1); i++) {
+        workers.emplace_back(&Server::RunWorker, this);
+    }
+    return true;
+}
+
+void Server::Run() {
+    // connections waiting for their next request
+    std::vector<int> idleFds;
+    std::vector<pollfd> pollFds;
+    while (!stopping) {
+        pollFds.clear();
+        pollFds.push_back({ wakeFds[0], POLLIN, 0 });
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            idleFds.insert(idleFds.end(), returnedFds.begin(), returnedFds.end());
+            returnedFds.clear();
+            if (openFds.size() < SERVER_MAX_CONNECTIONS) {
+                pollFds.push_back({ listenFd, POLLIN, 0 });
+            }
+        }
+        for (int fd : idleFds) {
+            pollFds.push_back({ fd, POLLIN, 0 });
+        }
+
+        if (poll(pollFds.data(), pollFds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (stopping) {
+            break;
+        }
+        if (pollFds[0].revents) {
+            char wakeBytes[64];
+            ssize_t numRead = read(wakeFds[0], wakeBytes, sizeof(wakeBytes));
+            (void)numRead;
+        }
+
+        // a request arriving, or the peer hanging up, goes to a worker. a
+        // worker finds out about a hang up by reading nothing.
+        u64 numIdle = 0;
+        u64 idleStart = pollFds.size() - idleFds.size();
+        bool anyQueued = false;
+        {
+            // once stopping, Stop has closed what was queued and what's
+            // left idle is closed below
+            std::lock_guard<std::mutex> lock(queueMutex);
+            for (u64 i = 0; i < idleFds.size(); i++) {
+                if (pollFds[idleStart + i].revents && !stopping) {
+                    queue.push_back(idleFds[i]);
+                    anyQueued = true;
+                } else {
+                    idleFds[numIdle++] = idleFds[i];
+                }
+            }
+        }
+        idleFds.resize(numIdle);
+        if (anyQueued) {
+            queueNotEmpty.notify_all();
+        }
+
+        if (idleStart > 1 && pollFds[1].revents) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN) {
+                    continue;
+                }
+                // Stop shut the socket down
+                break;
+            }
+            IgnoreSigPipe(fd);
+            SetTimeouts(fd, options.requestTimeoutMs);
+            std::lock_guard<std::mutex> lock(queueMutex);
+            openFds.insert(fd);
+            idleFds.push_back(fd);
+        }
+    }
+
+    // what the workers don't have is closed here, Stop closes the rest
+    for (int fd : idleFds) {
+        CloseConnection(fd);
+    }
+}
+
+void Server::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (stopping.exchange(true)) {
+            return;
+        }
+        // wakes up Run and every worker waiting on a client
+        if (listenFd >= 0) {
+            shutdown(listenFd, SHUT_RDWR);
+        }
+        if (wakeFds[1] >= 0) {
+            ssize_t numWritten = write(wakeFds[1], "", 1);
+            (void)numWritten;
+        }
+        for (int fd : openFds) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+    queueNotEmpty.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    std::vector<int> fds;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        fds.assign(queue.begin(), queue.end());
+        fds.insert(fds.end(), returnedFds.begin(), returnedFds.end());
+        queue.clear();
+        returnedFds.clear();
+    }
+    for (int fd : fds) {
+        CloseConnection(fd);
+    }
+}
+
+void Server::CloseConnection(int fd) {
+    {
+        // out of openFds before the number can be reused
+        std::lock_guard<std::mutex> lock(queueMutex);
+        openFds.erase(fd);
+    }
+    close(fd);
+}
+
+bool Server::IsNextRequestDue(int fd) {
+    {
+        // others are waiting for a worker
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!queue.empty() || stopping) {
+            return false;
+        }
+    }
+    pollfd pollFd = { fd, POLLIN, 0 };
+    return poll(&pollFd, 1, SERVER_LINGER_MS) > 0;
+}
+
+void Server::RunWorker() {
+    InstStream instStream(ByteSpan{nullptr, 0});
+    std::vector<u8> request;
+    OutputBuffer text;
+    while (true) {
+        int fd;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueNotEmpty.wait(lock, [&]() { return !queue.empty() || stopping; });
+            if (stopping) {
+                return;
+            }
+            fd = queue.front();
+            queue.pop_front();
+        }
+
+        bool isOpen;
+        while ((isOpen = ServeRequest(fd, instStream, request, text)) && IsNextRequestDue(fd)) {}
+        if (!isOpen) {
+            CloseConnection(fd);
+            continue;
+        }
+        {
+            // Stop closes it if the server is stopping
+            std::lock_guard<std::mutex> lock(queueMutex);
+            returnedFds.push_back(fd);
+        }
+        ssize_t numWritten = write(wakeFds[1], "", 1);
+        (void)numWritten;
+    }
+}
+
+bool Server::ServeRequest(int fd, InstStream& instStream, std::vector<u8>& request,
+                          OutputBuffer& text) {
+    u8 header[RESPONSE_HEADER_BYTES];
+    if (!ReadAll(fd, header, 4)) {
+        return false;
+    }
+    u32 size = GetU32(header);
+    if (size > options.maxRequestSize) {
+        header[0] = (u8)ServerStatus::TOO_LARGE;
+        PutU32((char *)header + 1, 0);
+        WriteAll(fd, header, RESPONSE_HEADER_BYTES, nullptr, 0);
+        return false;
+    }
+    request.resize(size);
+    if (!ReadAll(fd, request.data(), size)) {
+        return false;
+    }
+
+    ByteSpan code = {request.data(), request.size()};
+    instStream.Restart(code);
+    text.Clear();
+    bool ok = requestFn(code, instStream, text);
+
+    header[0] = (u8)(ok ? ServerStatus::OK : ServerStatus::DECODE_FAILED);
+    PutU32((char *)header + 1, (u32)text.Size());
+    return WriteAll(fd, header, RESPONSE_HEADER_BYTES, text.Data(), text.Size());
+}
+
+Client::Client() : fd(-1) {}
+
+Client::~Client() {
+    Close();
+}
+
+bool Client::Connect(const char *socketPath) {
+    Close();
+    sockaddr_un address;
+    if (!MakeAddress(socketPath, address)) {
+        return false;
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    IgnoreSigPipe(fd);
+    if (connect(fd, (sockaddr *)&address, sizeof(address)) < 0) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool Client::Disassemble(ByteSpan code, ServerStatus& status, std::string& text) {
+    u8 header[RESPONSE_HEADER_BYTES];
+    PutU32((char *)header, (u32)code.size);
+    if (fd < 0 || !WriteAll(fd, header, 4, code.data, code.size) ||
+        !ReadAll(fd, header, RESPONSE_HEADER_BYTES)) {
+        return false;
+    }
+    status = (ServerStatus)header[0];
+    text.resize(GetU32(header + 1));
+    return ReadAll(fd, (u8 *)&text[0], text.size());
+}
+
+void Client::Close() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+#endif
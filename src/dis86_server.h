@@ -0,0 +1,115 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <dis86_batch.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// largest request the server accepts by default
+#define DEFAULT_MAX_REQUEST_SIZE (16 * 1024 * 1024)
+// open connections before accept stops taking more
+#define SERVER_MAX_CONNECTIONS 1024
+// how long a request may take to arrive, or its response to be taken
+#define DEFAULT_REQUEST_TIMEOUT_MS 10000
+
+// protocol, all integers little endian. a connection carries any number of
+// requests one after the other:
+//   request:  u32 size, size bytes of machine code
+//   response: u8 status, u32 size, size bytes of disassembly text
+// on DECODE_FAILED the text covers everything before the invalid
+// instruction. on TOO_LARGE the server closes the connection.
+enum class ServerStatus : u8 {
+    OK,
+    DECODE_FAILED,
+    TOO_LARGE,
+};
+
+struct ServerOptions {
+    const char *socketPath = nullptr;
+    u32 numWorkers = 1;
+    u32 maxRequestSize = DEFAULT_MAX_REQUEST_SIZE;
+    // a client that stalls part way through a request is dropped after
+    // this long, 0 waits forever
+    u32 requestTimeoutMs = DEFAULT_REQUEST_TIMEOUT_MS;
+};
+
+// long running disassembly server on a unix domain socket. Run waits on
+// every open connection and queues one when a request starts to arrive, a
+// fixed pool of workers each take a connection off the queue, serve that one
+// request and hand the connection back. so idle clients hold no worker, only
+// clients with a request in flight do. workers keep their InstStream,
+// request buffer and output buffer from one request to the next. requests
+// are disassembled by the same kind of function as batch mode.
+// not available on windows, Start fails there.
+class Server {
+public:
+    Server(const ServerOptions& options, BatchFileFn requestFn);
+    ~Server();
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // binds the socket, replacing a stale one at the same path, and starts
+    // the workers. false with a message on stderr if that fails, or if the
+    // path is something other than a socket or a server still answers on it.
+    bool Start();
+    // accepts connections and hands their requests to the workers until
+    // Stop is called
+    void Run();
+    // callable from any thread. stops accepting, shuts down open connections
+    // and waits for the workers.
+    void Stop();
+
+private:
+    ServerOptions options;
+    BatchFileFn requestFn;
+    int listenFd;
+    // the socket file bound by Start, the destructor only removes the path
+    // if it is still this file
+    u64 socketDevice;
+    u64 socketInode;
+    // written to wake Run up when a connection is handed back or on Stop
+    int wakeFds[2];
+    std::atomic<bool> stopping;
+    std::vector<std::thread> workers;
+
+    std::mutex queueMutex;
+    std::condition_variable queueNotEmpty;
+    // connections with a request arriving, waiting for a worker
+    std::deque<int> queue;
+    // connections a worker is done with, for Run to wait on again
+    std::vector<int> returnedFds;
+    // every open connection, so Stop can shut them down
+    std::set<int> openFds;
+
+    void RunWorker();
+    // false if the connection should be closed
+    bool ServeRequest(int fd, InstStream& instStream, std::vector<u8>& request,
+                      OutputBuffer& text);
+    // true if the connection's next request comes in before anyone else
+    // needs the worker
+    bool IsNextRequestDue(int fd);
+    void CloseConnection(int fd);
+};
+
+// blocking client for one connection to a Server
+class Client {
+public:
+    Client();
+    ~Client();
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    bool Connect(const char *socketPath);
+    // sends code and waits for the disassembly. false if the connection
+    // failed, otherwise status says how the server got on.
+    bool Disassemble(ByteSpan code, ServerStatus& status, std::string& text);
+    void Close();
+
+private:
+    int fd;
+};
@@ -0,0 +1,165 @@
+#include <dis86_stats.h>
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+static std::mutex totalsMutex;
+static DecodeStats totals;
+
+// folds the thread's stats into the totals as the thread exits
+struct ThreadStats {
+    DecodeStats stats = {};
+
+    ~ThreadStats() {
+        std::lock_guard<std::mutex> lock(totalsMutex);
+        totals.Add(stats);
+    }
+};
+
+static thread_local ThreadStats threadStats;
+
+void DecodeStats::Add(const DecodeStats& other) {
+    for (u32 i = 0; i < NUM_FORMATS; i++) {
+        formatAttempts[i] += other.formatAttempts[i];
+        formatMatches[i] += other.formatMatches[i];
+    }
+    numInsts += other.numInsts;
+    numBytes += other.numBytes;
+    numFormatted += other.numFormatted;
+    for (u32 i = 0; i < (u8)StatsPhase::NUM_PHASES; i++) {
+        phaseTicks[i] += other.phaseTicks[i];
+    }
+    for (u32 i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+        decodeHistogram[i] += other.decodeHistogram[i];
+    }
+}
+
+const char *GetTickUnit() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+DecodeStats& GetThreadStats() {
+    return threadStats.stats;
+}
+
+DecodeStats CollectStats() {
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    DecodeStats stats = totals;
+    stats.Add(threadStats.stats);
+    return stats;
+}
+
+void ResetStats() {
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    totals = {};
+    threadStats.stats = {};
+}
+
+void RecordInstruction(u64 start, u64 decodeStart, u32 numBytes) {
+    u64 end = ReadTicks();
+    DecodeStats& stats = GetThreadStats();
+    stats.numInsts++;
+    stats.numBytes += numBytes;
+    stats.phaseTicks[(u8)StatsPhase::PREPARE] += decodeStart - start;
+    stats.phaseTicks[(u8)StatsPhase::DECODE] += end - decodeStart;
+
+    u64 ticks = end - decodeStart;
+    u32 bucket = 0;
+    while (ticks > 1 && bucket < STATS_HISTOGRAM_BUCKETS - 1) {
+        ticks >>= 1;
+        bucket++;
+    }
+    stats.decodeHistogram[bucket]++;
+}
+
+static const char *phaseNames[] = { "prepare", "decode", "format" };
+static_assert(ARR_SIZE(phaseNames) == (u8)StatsPhase::NUM_PHASES, "a phase has no name");
+
+static f64 PerItem(u64 total, u64 numItems) {
+    return numItems ? (f64)total / numItems : 0;
+}
+
+static std::string_view GetFormatName(u32 formatIdx) {
+    return Instruction(InstFormats::GetFormatOpType(formatIdx), {}, {}).GetOpStr();
+}
+
+static void WriteTable(const DecodeStats& stats, std::ostream& out) {
+    out << std::fixed << std::setprecision(2)
+        << "instructions  " << stats.numInsts << "\n"
+        << "bytes         " << stats.numBytes << " ("
+        << PerItem(stats.numBytes, stats.numInsts) << " per instruction)\n"
+        << "formatted     " << stats.numFormatted << "\n\n"
+        << "phase         " << std::setw(14) << GetTickUnit() << "  per instruction\n";
+    for (u32 i = 0; i < (u8)StatsPhase::NUM_PHASES; i++) {
+        // formatting is per formatted instruction, the rest per decoded one
+        u64 numItems = (i == (u8)StatsPhase::FORMAT) ? stats.numFormatted : stats.numInsts;
+        out << std::left << std::setw(14) << phaseNames[i] << std::right << std::setw(14)
+            << stats.phaseTicks[i] << "  " << PerItem(stats.phaseTicks[i], numItems) << "\n";
+    }
+
+    out << "\ndecode " << GetTickUnit() << " per instruction\n";
+    for (u32 i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+        if (stats.decodeHistogram[i] == 0) {
+            continue;
+        }
+        u64 low = (i == 0) ? 0 : (u64)1 << i;
+        out << "  [" << std::setw(10) << low << ", " << std::setw(10) << ((u64)1 << (i + 1))
+            << ")  " << std::setw(12) << stats.decodeHistogram[i] << "  "
+            << std::setw(6) << 100.0 * PerItem(stats.decodeHistogram[i], stats.numInsts) << "%\n";
+    }
+
+    // most matched first, formats never tried are left out
+    std::vector<u32> formatIdxs;
+    for (u32 i = 0; i < NUM_FORMATS; i++) {
+        if (stats.formatAttempts[i] != 0) {
+            formatIdxs.push_back(i);
+        }
+    }
+    std::stable_sort(formatIdxs.begin(), formatIdxs.end(), [&](u32 lhs, u32 rhs) {
+        return stats.formatMatches[lhs] > stats.formatMatches[rhs];
+    });
+    out << "\nformat  op        attempts       matches   hit rate\n";
+    for (u32 formatIdx : formatIdxs) {
+        out << std::setw(6) << formatIdx << "  " << std::left << std::setw(6)
+            << GetFormatName(formatIdx) << std::right
+            << std::setw(12) << stats.formatAttempts[formatIdx]
+            << std::setw(14) << stats.formatMatches[formatIdx]
+            << std::setw(10) << 100.0 * PerItem(stats.formatMatches[formatIdx],
+                                                stats.formatAttempts[formatIdx]) << "%\n";
+    }
+    out << std::defaultfloat << std::flush;
+}
+
+static void WriteJson(const DecodeStats& stats, std::ostream& out) {
+    out << "{\"instructions\": " << stats.numInsts
+        << ", \"bytes\": " << stats.numBytes
+        << ", \"formatted\": " << stats.numFormatted
+        << ", \"tick_unit\": \"" << GetTickUnit() << "\", \"phases\": {";
+    for (u32 i = 0; i < (u8)StatsPhase::NUM_PHASES; i++) {
+        out << (i ? ", " : "") << "\"" << phaseNames[i] << "\": " << stats.phaseTicks[i];
+    }
+    out << "}, \"decode_histogram\": [";
+    for (u32 i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+        out << (i ? ", " : "") << stats.decodeHistogram[i];
+    }
+    out << "], \"formats\": [";
+    for (u32 i = 0; i < NUM_FORMATS; i++) {
+        out << (i ? ", " : "") << "{\"index\": " << i << ", \"op\": \"" << GetFormatName(i)
+            << "\", \"attempts\": " << stats.formatAttempts[i]
+            << ", \"matches\": " << stats.formatMatches[i] << "}";
+    }
+    out << "]}" << std::endl;
+}
+
+void WriteStats(const DecodeStats& stats, bool json, std::ostream& out) {
+    if (json) {
+        WriteJson(stats, out);
+    } else {
+        WriteTable(stats, out);
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <dis86_inst_format.h>
+#include <chrono>
+#include <ostream>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// instrumentation of the decode and format hot paths. the hooks are only
+// compiled in when the build defines DIS86_STATS (cmake -DDIS86_STATS=ON),
+// otherwise STATS(...) expands to nothing and none of this is called.
+#ifdef DIS86_STATS
+#define STATS(statement) statement
+#else
+#define STATS(statement)
+#endif
+
+// log2 buckets of the per instruction decode time
+#define STATS_HISTOGRAM_BUCKETS 32
+
+enum class StatsPhase : u8 {
+    PREPARE, // refilling and bounds checks before each instruction
+    DECODE,  // dispatch, decoding and committing the instruction
+    FORMAT,  // writing an instruction as text
+    NUM_PHASES,
+};
+
+struct DecodeStats {
+    // per index into InstStream's formats. an attempt is a comparison of
+    // the format's literal bits with the input, a match one that decoded.
+    u64 formatAttempts[NUM_FORMATS];
+    u64 formatMatches[NUM_FORMATS];
+    u64 numInsts;
+    u64 numBytes;
+    u64 numFormatted;
+    u64 phaseTicks[(u8)StatsPhase::NUM_PHASES];
+    // bucket i counts instructions that took [2^i, 2^(i + 1)) ticks to
+    // decode, bucket 0 also takes 0
+    u64 decodeHistogram[STATS_HISTOGRAM_BUCKETS];
+
+    void Add(const DecodeStats& other);
+};
+
+// cycles where the cpu has a time stamp counter, nanoseconds elsewhere
+inline u64 ReadTicks() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+// ReadTicks when stats are counted, otherwise 0 so the timing folds away
+inline u64 ReadStatsTicks() {
+#ifdef DIS86_STATS
+    return ReadTicks();
+#else
+    return 0;
+#endif
+}
+const char *GetTickUnit();
+
+// the calling thread's stats. each thread counts on its own and adds its
+// stats to the totals when it exits.
+DecodeStats& GetThreadStats();
+// totals of the threads that have exited plus the calling thread's
+DecodeStats CollectStats();
+// clears the totals and the calling thread's stats
+void ResetStats();
+
+// one instruction from the start of NextInstruction, decodeStart is where
+// the prepare phase ended
+void RecordInstruction(u64 start, u64 decodeStart, u32 numBytes);
+
+// adds the ticks from construction to destruction to a phase
+class StatsTimer {
+public:
+    explicit StatsTimer(StatsPhase phase) : phase(phase), start(ReadTicks()) {}
+    ~StatsTimer() {
+        GetThreadStats().phaseTicks[(u8)phase] += ReadTicks() - start;
+    }
+
+private:
+    StatsPhase phase;
+    u64 start;
+};
+
+// aligned columns, or one json object
+void WriteStats(const DecodeStats& stats, bool json, std::ostream& out);
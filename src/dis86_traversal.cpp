@@ -0,0 +1,187 @@
+#include <dis86_traversal.h>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+// bytes per db line of data
+#define DATA_LINE_BYTES 16
+
+Traversal::Traversal(ByteSpan image)
+    : image(image), codeBits(image.size), claimBits(image.size), blockStartBits(image.size),
+      instLengths(image.size), pendingTargets(0), instStream(ByteSpan{image.data, 0}) {}
+
+void Traversal::AddEntryPoint(u64 offset) {
+    if (offset < image.size) {
+        blockStartBits.Set(offset);
+        entryPoints.push_back(offset);
+    }
+}
+
+void Traversal::Run(u32 numThreads) {
+    numThreads = std::max<u32>(numThreads, 1);
+    deques.clear();
+    for (u32 i = 0; i < numThreads; i++) {
+        deques.emplace_back(new WorkDeque());
+    }
+    // the workers haven't started so the entry points can go in any deque
+    for (u64 i = 0; i < entryPoints.size(); i++) {
+        deques[i % numThreads]->Push(entryPoints[i]);
+    }
+    pendingTargets.store(entryPoints.size(), std::memory_order_relaxed);
+    entryPoints.clear();
+
+    std::vector<std::thread> workers;
+    for (u32 i = 1; i < numThreads; i++) {
+        workers.emplace_back(&Traversal::RunWorker, this, i);
+    }
+    RunWorker(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    BuildBlocks();
+}
+
+void Traversal::RunWorker(u32 workerIdx) {
+    InstStream stream(ByteSpan{image.data, 0});
+    WorkDeque& deque = *deques[workerIdx];
+    u32 numDeques = (u32)deques.size();
+
+    while (pendingTargets.load(std::memory_order_acquire) != 0) {
+        u64 offset;
+        bool found = deque.Pop(offset);
+        for (u32 i = 1; !found && i < numDeques; i++) {
+            found = deques[(workerIdx + i) % numDeques]->Steal(offset);
+        }
+        if (!found) {
+            // the remaining targets are being decoded by other workers,
+            // which may still push more
+            std::this_thread::yield();
+            continue;
+        }
+        DecodeFrom(stream, deque, offset);
+        pendingTargets.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+void Traversal::DecodeFrom(InstStream& stream, WorkDeque& deque, u64 offset) {
+    stream.Restart(ByteSpan{image.data + offset, image.size - offset}, offset);
+    while (stream.GetOffset() < image.size) {
+        u64 start = stream.GetOffset();
+        if (claimBits.TestAndSet(start)) {
+            // flow joins code another decode got to first. whichever of the
+            // two arrives second marks the join, so it is marked either way.
+            blockStartBits.Set(start);
+            return;
+        }
+        Instruction inst = stream.NextInstruction();
+        if (!inst) {
+            return;
+        }
+        u64 end = start + inst.GetLength();
+        instLengths[start] = inst.GetLength();
+        codeBits.SetRange(start, end);
+
+        i64 target;
+        if (inst.GetBranchTarget(target) && target >= 0 && (u64)target < image.size) {
+            blockStartBits.Set(target);
+            if (!claimBits.Test(target)) {
+                // counted before it is pushed so the count can't reach 0
+                // while the target is in a deque
+                pendingTargets.fetch_add(1, std::memory_order_relaxed);
+                deque.Push(target);
+            }
+        }
+        if (inst.IsControlFlow()) {
+            if (end < image.size) {
+                blockStartBits.Set(end);
+            }
+            if (!inst.FallsThrough()) {
+                return;
+            }
+        }
+    }
+}
+
+void Traversal::BuildBlocks() {
+    blocks.clear();
+    // end of the last instruction put in a block. decodes that start inside
+    // it disagree with it on where instructions start, the lower address wins.
+    u64 keptEnd = 0;
+    for (u64 offset = claimBits.FindNext(0); offset < image.size;
+         offset = claimBits.FindNext(offset + 1)) {
+        u8 length = instLengths[offset];
+        if (length == 0 || offset < keptEnd) {
+            continue;
+        }
+        if (blocks.empty() || blocks.back().end != offset || blockStartBits.Test(offset)) {
+            blocks.push_back({offset, offset, 0});
+        }
+        keptEnd = offset + length;
+        blocks.back().end = keptEnd;
+        blocks.back().numInsts++;
+    }
+}
+
+bool Traversal::IsCode(u64 offset) const {
+    return offset < image.size && codeBits.Test(offset);
+}
+
+bool Traversal::IsInstStart(u64 offset) const {
+    return offset < image.size && instLengths[offset] != 0;
+}
+
+const std::vector<BasicBlock>& Traversal::GetBlocks() const {
+    return blocks;
+}
+
+static char *WriteHeader(char *out, const char *kind, u64 offset) {
+    std::memcpy(out, kind, std::strlen(kind));
+    out = FormatOffset(out + std::strlen(kind), offset);
+    *out++ = '\n';
+    return out;
+}
+
+void Traversal::FormatData(OutputBuffer& out, u64 start, u64 end) {
+    char *line = out.Reserve(MAX_INST_STR_LEN);
+    out.Commit(WriteHeader(line, "; data ", start));
+    for (u64 lineStart = start; lineStart < end; lineStart += DATA_LINE_BYTES) {
+        u64 lineEnd = std::min<u64>(lineStart + DATA_LINE_BYTES, end);
+        // "db " and up to 16 of "255, "
+        line = out.Reserve(3 + DATA_LINE_BYTES * 5 + 1);
+        std::memcpy(line, "db ", 3);
+        line += 3;
+        for (u64 i = lineStart; i < lineEnd; i++) {
+            if (i != lineStart) {
+                *line++ = ',';
+                *line++ = ' ';
+            }
+            line = FormatInt(line, image.data[i]);
+        }
+        *line++ = '\n';
+        out.Commit(line);
+    }
+}
+
+void Traversal::Format(OutputBuffer& out) {
+    u64 offset = 0;
+    for (const BasicBlock& block : blocks) {
+        if (offset < block.start) {
+            FormatData(out, offset, block.start);
+        }
+        char *line = out.Reserve(MAX_INST_STR_LEN);
+        out.Commit(WriteHeader(line, "; code ", block.start));
+
+        // the traversal only keeps the bitmaps, the block is decoded again
+        // for its text
+        instStream.Restart(ByteSpan{image.data + block.start, block.end - block.start},
+                           block.start);
+        for (u32 i = 0; i < block.numInsts; i++) {
+            Instruction inst = instStream.NextInstruction();
+            inst.Format(out);
+        }
+        offset = block.end;
+    }
+    if (offset < image.size) {
+        FormatData(out, offset, image.size);
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <dis86_basic_block.h>
+#include <dis86_bitmap.h>
+#include <dis86_instruction_stream.h>
+#include <dis86_output_buffer.h>
+#include <dis86_work_deque.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// recursive traversal disassembly: control flow is followed from the entry
+// points with a worklist, so data mixed in with the code is never decoded as
+// instructions. bitmaps with a bit per byte of the image record which bytes
+// were decoded as code and where basic blocks start, plus a byte per byte for
+// the length of the instruction starting there, so memory depends on the
+// image size, not on the number of paths through it.
+//
+// the work can be spread over threads. each worker has its own decode state
+// and deque of branch targets and steals from the others when it runs dry.
+// an instruction start is claimed with an atomic test and set before it is
+// decoded, so each one is decoded exactly once by whichever worker gets there
+// first. the set of claimed starts is the same whatever the order, and blocks
+// are built from it in address order afterwards, so the result doesn't depend
+// on the number of threads or how they were scheduled.
+class Traversal {
+public:
+    // image must outlive the traversal
+    explicit Traversal(ByteSpan image);
+
+    void AddEntryPoint(u64 offset);
+    // decodes everything reachable from the entry points added so far on
+    // numThreads threads, then splits the code into basic blocks
+    void Run(u32 numThreads = 1);
+
+    bool IsCode(u64 offset) const;
+    bool IsInstStart(u64 offset) const;
+    // in address order, valid after Run
+    const std::vector<BasicBlock>& GetBlocks() const;
+
+    // writes the basic blocks and the data between them in address order,
+    // data as db lines so the output assembles back into the image
+    void Format(OutputBuffer& out);
+
+private:
+    ByteSpan image;
+    Bitmap codeBits;
+    Bitmap claimBits;
+    Bitmap blockStartBits;
+    // length of the instruction starting at each offset, 0 if none. only
+    // written by the worker that claimed the offset.
+    std::vector<u8> instLengths;
+    std::vector<u64> entryPoints;
+    std::vector<std::unique_ptr<WorkDeque>> deques;
+    // targets pushed but not yet decoded from, the workers stop at 0
+    std::atomic<u64> pendingTargets;
+    std::vector<BasicBlock> blocks;
+    InstStream instStream;
+
+    void RunWorker(u32 workerIdx);
+    // decodes in a straight line from offset until control doesn't fall
+    // through or the decode reaches an instruction already claimed
+    void DecodeFrom(InstStream& stream, WorkDeque& deque, u64 offset);
+    void BuildBlocks();
+    void FormatData(OutputBuffer& out, u64 start, u64 end);
+};
@@ -0,0 +1,70 @@
+#include <dis86_work_deque.h>
+
+// must be a power of 2
+#define INITIAL_CAPACITY 256
+
+// memory orders follow Le, Pop, Cohen and Zappa Nardelli, "Correct and
+// Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013)
+
+WorkDeque::WorkDeque() : top(0), bottom(0) {
+    rings.emplace_back(new Ring(INITIAL_CAPACITY));
+    ring.store(rings.back().get(), std::memory_order_relaxed);
+}
+
+WorkDeque::Ring *WorkDeque::Grow(Ring *old, i64 top, i64 bottom) {
+    rings.emplace_back(new Ring(old->Capacity() * 2));
+    Ring *grown = rings.back().get();
+    for (i64 i = top; i < bottom; i++) {
+        grown->Put(i, old->Get(i));
+    }
+    return grown;
+}
+
+void WorkDeque::Push(u64 value) {
+    i64 b = bottom.load(std::memory_order_relaxed);
+    i64 t = top.load(std::memory_order_acquire);
+    Ring *r = ring.load(std::memory_order_relaxed);
+    if ((u64)(b - t) >= r->Capacity()) {
+        r = Grow(r, t, b);
+        ring.store(r, std::memory_order_release);
+    }
+    r->Put(b, value);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+bool WorkDeque::Pop(u64& value) {
+    i64 b = bottom.load(std::memory_order_relaxed) - 1;
+    Ring *r = ring.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    i64 t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        // was already empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+    value = r->Get(b);
+    if (t == b) {
+        // last value, race the thieves for it
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                               std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+bool WorkDeque::Steal(u64& value) {
+    i64 t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    i64 b = bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+        return false;
+    }
+    Ring *r = ring.load(std::memory_order_acquire);
+    value = r->Get(t);
+    return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed);
+}
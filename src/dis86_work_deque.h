@@ -0,0 +1,43 @@
+#pragma once
+#include <dis86_num_types.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Chase-Lev work stealing deque of offsets. the owning thread pushes and
+// pops at the bottom, any other thread steals from the top. the ring grows
+// when full, old rings are kept until the deque is destroyed because a
+// thief may still be reading one.
+class WorkDeque {
+public:
+    WorkDeque();
+
+    // owner only
+    void Push(u64 value);
+    bool Pop(u64& value);
+    // any thread, false if the deque is empty or another thread won the race
+    bool Steal(u64& value);
+
+private:
+    struct Ring {
+        explicit Ring(u64 capacity) : values(new std::atomic<u64>[capacity]), mask(capacity - 1) {}
+
+        inline u64 Get(i64 idx) const {
+            return values[idx & mask].load(std::memory_order_relaxed);
+        }
+        inline void Put(i64 idx, u64 value) {
+            values[idx & mask].store(value, std::memory_order_relaxed);
+        }
+        u64 Capacity() const { return mask + 1; }
+
+        std::unique_ptr<std::atomic<u64>[]> values;
+        u64 mask;
+    };
+
+    std::atomic<i64> top;
+    std::atomic<i64> bottom;
+    std::atomic<Ring *> ring;
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    Ring *Grow(Ring *old, i64 top, i64 bottom);
+};
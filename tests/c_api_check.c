@@ -0,0 +1,16 @@
+/* built as C, to keep dis86_c.h usable from C */
+#include <dis86_c.h>
+#include <string.h>
+
+int DecodeAndFormatFromC(char *out, size_t cap) {
+    const uint8_t code[] = { 0x89, 0xd9 };
+    dis86_inst inst;
+    dis86_decoder *decoder = dis86_decoder_new();
+    size_t count;
+    if (!decoder) {
+        return 0;
+    }
+    count = dis86_decode(decoder, code, sizeof(code), &inst, 1);
+    dis86_decoder_free(decoder);
+    return count == 1 && dis86_format(&inst, out, cap) == strlen(out);
+}
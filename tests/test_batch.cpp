@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <dis86_inst_batch.h>
+#include <dis86_instruction_stream.h>
+#include "test_util.h"
+
+TEST(BATCH_TEST, MatchesNextInstruction) {
+    std::vector<u8> bytes = ReadAsmFile("all_supported");
+    ASSERT_FALSE(bytes.empty());
+    ByteSpan span = {bytes.data(), bytes.size()};
+
+    InstBatch batch;
+    ASSERT_TRUE(DecodeBatch(span, batch));
+
+    InstStream instStream(span);
+    u64 offset = 0;
+    for (u64 i = 0; i < batch.Size(); i++) {
+        Instruction inst = instStream.NextInstruction();
+        ASSERT_TRUE(inst);
+        EXPECT_EQ(batch.Get(i), inst) << "instruction index:" << i;
+        // operator== ignores memory operand widths, the text doesn't
+        char expectedStr[MAX_INST_STR_LEN], str[MAX_INST_STR_LEN];
+        EXPECT_EQ(std::string(str, batch.Get(i).Format(str)),
+                  std::string(expectedStr, inst.Format(expectedStr)));
+        EXPECT_EQ(batch.opTypes[i], inst.GetOpType()) << "instruction index:" << i;
+        EXPECT_EQ(batch.offsets[i], offset) << "instruction index:" << i;
+        offset = instStream.GetOffset();
+        EXPECT_EQ(batch.lengths[i], offset - batch.offsets[i]) << "instruction index:" << i;
+    }
+    EXPECT_FALSE(instStream.NextInstruction());
+    EXPECT_EQ(offset, bytes.size());
+}
+
+TEST(BATCH_TEST, ReusesAllocations) {
+    std::vector<u8> bytes = ReadAsmFile("all_supported");
+    ByteSpan span = {bytes.data(), bytes.size()};
+
+    InstBatch batch;
+    DecodeBatch(span, batch);
+    const OpType *opTypes = batch.opTypes.data();
+    const u32 *offsets = batch.offsets.data();
+    u64 size = batch.Size();
+
+    DecodeBatch(span, batch);
+    EXPECT_EQ(batch.Size(), size);
+    EXPECT_EQ(batch.opTypes.data(), opTypes);
+    EXPECT_EQ(batch.offsets.data(), offsets);
+}
+
+TEST(BATCH_TEST, StopsAtInvalidInstruction) {
+    // mov ax, bx then a byte that is not an 8086 opcode
+    const u8 bytes[] = { 0x89, 0xd8, 0x60, 0x89, 0xd8 };
+    InstBatch batch;
+    EXPECT_FALSE(DecodeBatch(ByteSpan{bytes, ARR_SIZE(bytes)}, batch));
+    EXPECT_EQ(batch.Size(), 1u);
+}
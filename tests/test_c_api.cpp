@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <dis86_c.h>
+#include <dis86_instruction_stream.h>
+#include "test_util.h"
+
+extern "C" int DecodeAndFormatFromC(char *out, size_t cap);
+
+TEST(C_API_TEST, MatchesInstStream) {
+    std::vector<u8> file = ReadAsmFile("all_supported");
+    ASSERT_FALSE(file.empty());
+
+    std::string expected;
+    InstStream instStream(ByteSpan{file.data(), file.size()});
+    Instruction inst;
+    char text[MAX_INST_STR_LEN];
+    while (inst = instStream.NextInstruction()) {
+        expected.append(text, inst.Format(text));
+        expected += '\n';
+    }
+    ASSERT_FALSE(instStream.Failed());
+
+    // a small array, so decoding has to go on from where each call stopped
+    dis86_decoder *decoder = dis86_decoder_new();
+    ASSERT_NE(decoder, nullptr);
+    dis86_inst insts[7];
+    std::string got;
+    char cText[DIS86_MAX_INST_STR_LEN + 1];
+    size_t start = 0;
+    while (start < file.size()) {
+        size_t count = dis86_decode(decoder, file.data() + start, file.size() - start,
+                                    insts, ARR_SIZE(insts));
+        ASSERT_EQ(dis86_decoder_status(decoder), DIS86_OK);
+        ASSERT_GT(count, 0u);
+        for (size_t i = 0; i < count; i++) {
+            size_t textLen = dis86_format(&insts[i], cText, sizeof(cText));
+            ASSERT_GT(textLen, 0u);
+            got.append(cText, textLen);
+            got += '\n';
+        }
+        start += insts[count - 1].offset + insts[count - 1].length;
+    }
+    dis86_decoder_free(decoder);
+    EXPECT_EQ(got, expected);
+}
+
+TEST(C_API_TEST, InvalidAndTruncated) {
+    dis86_decoder *decoder = dis86_decoder_new();
+    dis86_inst insts[4];
+
+    const u8 invalid[] = { 0x40, 0x60, 0x40 }; // inc ax, not an 8086 instruction
+    EXPECT_EQ(dis86_decode(decoder, invalid, sizeof(invalid), insts, 4), 1u);
+    EXPECT_EQ(dis86_decoder_status(decoder), DIS86_INVALID);
+
+    const u8 truncated[] = { 0x40, 0xb8, 0x2a }; // inc ax, mov ax missing a byte
+    EXPECT_EQ(dis86_decode(decoder, truncated, sizeof(truncated), insts, 4), 1u);
+    EXPECT_EQ(dis86_decoder_status(decoder), DIS86_TRUNCATED);
+
+    const u8 rep[] = { 0xf3, 0xa4 };
+    ASSERT_EQ(dis86_decode(decoder, rep, sizeof(rep), insts, 4), 1u);
+    EXPECT_EQ(dis86_decoder_status(decoder), DIS86_OK);
+    EXPECT_EQ(insts[0].prefix, DIS86_PREFIX_REP);
+    EXPECT_EQ(insts[0].length, 2);
+    EXPECT_STREQ(dis86_op_name(insts[0].op), "movsb");
+    EXPECT_EQ(dis86_op_name(255), nullptr);
+    dis86_decoder_free(decoder);
+}
+
+TEST(C_API_TEST, Format) {
+    dis86_decoder *decoder = dis86_decoder_new();
+    const u8 code[] = { 0xea, 0x34, 0x12, 0x78, 0x56 }; // jmp 0x5678:0x1234
+    dis86_inst inst;
+    ASSERT_EQ(dis86_decode(decoder, code, sizeof(code), &inst, 1), 1u);
+    dis86_decoder_free(decoder);
+
+    char text[DIS86_MAX_INST_STR_LEN + 1];
+    size_t textLen = dis86_format(&inst, text, sizeof(text));
+    EXPECT_EQ(textLen, strlen(text));
+
+    // cut short like snprintf
+    char shortText[5];
+    EXPECT_EQ(dis86_format(&inst, shortText, sizeof(shortText)), textLen);
+    EXPECT_EQ(std::string(shortText), std::string(text, 4));
+
+    dis86_inst bad = inst;
+    bad.operands[0].type = 7;
+    EXPECT_EQ(dis86_format(&bad, text, sizeof(text)), 0u);
+    EXPECT_STREQ(text, "");
+    bad = inst;
+    bad.op = 0;
+    EXPECT_EQ(dis86_format(&bad, text, sizeof(text)), 0u);
+
+    EXPECT_TRUE(DecodeAndFormatFromC(text, sizeof(text)));
+    EXPECT_STREQ(text, "mov cx, bx");
+    EXPECT_EQ(dis86_abi_version(), (u32)DIS86_ABI_VERSION);
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <dis86_cfg.h>
+#include <dis86_instruction_stream.h>
+
+static void AddLinearSweep(ControlFlowGraph& cfg, const std::vector<u8>& image) {
+    InstStream instStream(ByteSpan{image.data(), image.size()});
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        cfg.AddInstruction(inst);
+    }
+    ASSERT_FALSE(instStream.Failed());
+}
+
+static std::vector<u32> Succs(const ControlFlowGraph& cfg, u32 blockIdx) {
+    return std::vector<u32>(cfg.SuccsBegin(blockIdx), cfg.SuccsEnd(blockIdx));
+}
+
+static std::vector<u32> Preds(const ControlFlowGraph& cfg, u32 blockIdx) {
+    return std::vector<u32>(cfg.PredsBegin(blockIdx), cfg.PredsEnd(blockIdx));
+}
+
+static const std::vector<u8> program = {
+    0xb9, 0x03, 0x00, // 0: mov cx, word 3
+    0x40,             // 3: inc ax
+    0x43,             // 4: inc bx
+    0xe2, 0xfc,       // 5: loop to 3
+    0x74, 0x01,       // 7: je to 10
+    0x48,             // 9: dec ax
+    0xe8, 0x02, 0x00, // 10: call 15
+    0xeb, 0xfe,       // 13: jmp to itself
+    0xc3,             // 15: ret
+};
+
+TEST(CFG_TEST, BlocksAndEdges) {
+    ControlFlowGraph cfg;
+    AddLinearSweep(cfg, program);
+    cfg.Build();
+
+    struct { u64 start, end; u32 numInsts; } expected[] = {
+        { 0, 3, 1 }, { 3, 7, 3 }, { 7, 9, 1 }, { 9, 10, 1 },
+        { 10, 13, 1 }, { 13, 15, 1 }, { 15, 16, 1 },
+    };
+    ASSERT_EQ(cfg.NumBlocks(), ARR_SIZE(expected));
+    for (u32 i = 0; i < cfg.NumBlocks(); i++) {
+        EXPECT_EQ(cfg.GetBlock(i).start, expected[i].start) << "block " << i;
+        EXPECT_EQ(cfg.GetBlock(i).end, expected[i].end) << "block " << i;
+        EXPECT_EQ(cfg.GetBlock(i).numInsts, expected[i].numInsts) << "block " << i;
+    }
+
+    EXPECT_EQ(cfg.NumEdges(), 9u);
+    EXPECT_EQ(Succs(cfg, 0), (std::vector<u32>{ 1 }));
+    EXPECT_EQ(Succs(cfg, 1), (std::vector<u32>{ 2, 1 }));
+    EXPECT_EQ(Succs(cfg, 2), (std::vector<u32>{ 3, 4 }));
+    EXPECT_EQ(Succs(cfg, 3), (std::vector<u32>{ 4 }));
+    EXPECT_EQ(Succs(cfg, 4), (std::vector<u32>{ 5, 6 }));
+    EXPECT_EQ(Succs(cfg, 5), (std::vector<u32>{ 5 }));
+    EXPECT_EQ(Succs(cfg, 6), (std::vector<u32>{}));
+
+    EXPECT_EQ(cfg.SuccKinds(1)[1], EdgeKind::JUMP);
+    EXPECT_EQ(cfg.SuccKinds(2)[0], EdgeKind::FALL_THROUGH);
+    EXPECT_EQ(cfg.SuccKinds(4)[1], EdgeKind::CALL);
+
+    EXPECT_EQ(Preds(cfg, 0), (std::vector<u32>{}));
+    EXPECT_EQ(Preds(cfg, 1), (std::vector<u32>{ 0, 1 }));
+    EXPECT_EQ(Preds(cfg, 4), (std::vector<u32>{ 2, 3 }));
+    EXPECT_EQ(Preds(cfg, 5), (std::vector<u32>{ 4, 5 }));
+    EXPECT_EQ(Preds(cfg, 6), (std::vector<u32>{ 4 }));
+
+    EXPECT_EQ(cfg.FindBlock(10), 4u);
+    EXPECT_EQ(cfg.FindBlock(11), cfg.NumBlocks());
+}
+
+TEST(CFG_TEST, GapsAndTargetsInsideInstructions) {
+    // instructions as a traversal would give them, with data skipped
+    std::vector<u8> image = {
+        0xeb, 0x03,       // 0: jmp to 5
+        0xff, 0xff, 0xff, // 2: data
+        0x40,             // 5: inc ax
+        0x75, 0xfa,       // 6: jne to 2, which is not an instruction
+    };
+    InstStream instStream(ByteSpan{image.data(), image.size()});
+    ControlFlowGraph cfg;
+    cfg.AddInstruction(instStream.NextInstruction());
+    instStream.Restart(ByteSpan{image.data() + 5, image.size() - 5}, 5);
+    cfg.AddInstruction(instStream.NextInstruction());
+    cfg.AddInstruction(instStream.NextInstruction());
+    cfg.Build();
+
+    ASSERT_EQ(cfg.NumBlocks(), 2u);
+    EXPECT_EQ(cfg.GetBlock(1).start, 5u);
+    EXPECT_EQ(cfg.GetBlock(1).numInsts, 2u);
+    EXPECT_EQ(Succs(cfg, 0), (std::vector<u32>{ 1 }));
+    EXPECT_EQ(cfg.SuccKinds(0)[0], EdgeKind::JUMP);
+    EXPECT_EQ(Succs(cfg, 1), (std::vector<u32>{}));
+}
+
+TEST(CFG_TEST, Dot) {
+    const std::vector<u8> image = {
+        0x74, 0x01, // 0: je to 3
+        0x40,       // 2: inc ax
+        0xc3,       // 3: ret
+    };
+    ControlFlowGraph cfg;
+    AddLinearSweep(cfg, image);
+    cfg.Build();
+
+    OutputBuffer out;
+    cfg.WriteDot(out);
+    EXPECT_EQ(std::string(out.Data(), out.Size()),
+        "digraph cfg {\n"
+        "    b0 [label=\"00000000-00000002\\n1 insts\"];\n"
+        "    b1 [label=\"00000002-00000003\\n1 insts\"];\n"
+        "    b2 [label=\"00000003-00000004\\n1 insts\"];\n"
+        "    b0 -> b1;\n"
+        "    b0 -> b2 [label=\"jump\"];\n"
+        "    b1 -> b2;\n"
+        "}\n");
+}
+
+TEST(CFG_TEST, BinaryRoundTrip) {
+    ControlFlowGraph cfg;
+    AddLinearSweep(cfg, program);
+    cfg.Build();
+
+    OutputBuffer out;
+    cfg.WriteBinary(out);
+    const u8 *bytes = (const u8 *)out.Data();
+
+    ControlFlowGraph read;
+    ASSERT_TRUE(read.ReadBinary(bytes, out.Size()));
+    EXPECT_TRUE(read == cfg);
+    for (u32 i = 0; i < cfg.NumBlocks(); i++) {
+        EXPECT_EQ(Preds(read, i), Preds(cfg, i)) << "block " << i;
+    }
+
+    // truncated, and an edge to a block that doesn't exist
+    ControlFlowGraph bad;
+    EXPECT_FALSE(bad.ReadBinary(bytes, out.Size() - 1));
+    std::vector<u8> corrupt(bytes, bytes + out.Size());
+    u64 firstSucc = 16 + cfg.NumBlocks() * 20 + (cfg.NumBlocks() + 1) * 4;
+    corrupt[firstSucc] = 100;
+    EXPECT_FALSE(bad.ReadBinary(corrupt.data(), corrupt.size()));
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <dis86_instruction_stream.h>
+#include <dis86_packed_instruction.h>
+#include <dis86_labels.h>
+
+static std::string Disassemble(const std::vector<u8>& bytes, bool linear = false) {
+    InstStream instStream(ByteSpan{bytes.data(), bytes.size()});
+    std::string text;
+    Instruction inst;
+    while (inst = linear ? instStream.NextInstructionLinear() : instStream.NextInstruction()) {
+        char line[MAX_INST_STR_LEN];
+        text.append(line, inst.Format(line));
+        text += '\n';
+    }
+    EXPECT_FALSE(instStream.Failed());
+    return text;
+}
+
+static std::string DisassembleLabels(const std::vector<u8>& bytes, bool expectOk = true) {
+    InstStream instStream(ByteSpan{bytes.data(), bytes.size()});
+    OutputBuffer out;
+    EXPECT_EQ(DisassembleWithLabels(instStream, out), expectOk);
+    return std::string(out.Data(), out.Size());
+}
+
+TEST(CONTROL_FLOW_TEST, Jumps) {
+    const std::vector<u8> bytes = {
+        0x74, 0xfe,                   // je $+0
+        0x7f, 0x10,                   // jg $+18
+        0xe2, 0xf0,                   // loop $-14
+        0xe3, 0x00,                   // jcxz $+2
+        0xeb, 0x80,                   // jmp $-126
+        0xe9, 0x34, 0x12,             // jmp $+4663
+        0xe8, 0xfd, 0xff,             // call $+0
+        0xea, 0x78, 0x56, 0x34, 0x12, // jmp 4660:22136
+        0x9a, 0x00, 0x01, 0x00, 0x20, // call 8192:256
+        0xff, 0x17,                   // call word [bx]
+        0xff, 0xd3,                   // call bx
+        0xff, 0x1f,                   // call far [bx]
+        0xff, 0x67, 0x04,             // jmp word [bx + 4]
+        0xff, 0x2e, 0x00, 0x10,       // jmp far [4096]
+    };
+    const char *expected =
+        "je $+0\n"
+        "jg $+18\n"
+        "loop $-14\n"
+        "jcxz $+2\n"
+        "jmp $-126\n"
+        "jmp $+4663\n"
+        "call $+0\n"
+        "jmp 4660:22136\n"
+        "call 8192:256\n"
+        "call word [bx]\n"
+        "call bx\n"
+        "call far [bx]\n"
+        "jmp word [bx + 4]\n"
+        "jmp far [4096]\n";
+    EXPECT_EQ(Disassemble(bytes), expected);
+    EXPECT_EQ(Disassemble(bytes, true), expected);
+}
+
+TEST(CONTROL_FLOW_TEST, ReturnsAndInterrupts) {
+    const std::vector<u8> bytes = {
+        0xc3, 0xc2, 0x08, 0x00, 0xcb, 0xca, 0x04, 0x00,
+        0xcd, 0x21, 0xcc, 0xce, 0xcf,
+    };
+    EXPECT_EQ(Disassemble(bytes),
+        "ret \n"
+        "ret word 8\n"
+        "retf \n"
+        "retf word 4\n"
+        "int byte 33\n"
+        "int3 \n"
+        "into \n"
+        "iret \n");
+}
+
+TEST(CONTROL_FLOW_TEST, StringInstructions) {
+    const std::vector<u8> bytes = {
+        0xa4, 0xab, 0xf3, 0xa5, 0xf3, 0xa6, 0xf2, 0xae, 0xf3, 0xac,
+    };
+    const char *expected =
+        "movsb \n"
+        "stosw \n"
+        "rep movsw \n"
+        "repe cmpsb \n"
+        "repne scasb \n"
+        "rep lodsb \n";
+    EXPECT_EQ(Disassemble(bytes), expected);
+    EXPECT_EQ(Disassemble(bytes, true), expected);
+
+    InstStream instStream(ByteSpan{bytes.data(), bytes.size()});
+    u64 lengths[] = { 1, 1, 2, 2, 2, 2 };
+    for (u64 length : lengths) {
+        Instruction inst = instStream.NextInstruction();
+        ASSERT_TRUE(inst);
+        EXPECT_EQ(inst.GetLength(), length);
+    }
+}
+
+TEST(CONTROL_FLOW_TEST, PrefixNeedsStringInstruction) {
+    // rep in front of a mov
+    const u8 bytes[] = { 0x89, 0xd8, 0xf3, 0x89, 0xd8 };
+    InstStream instStream(ByteSpan{bytes, ARR_SIZE(bytes)});
+    EXPECT_TRUE(instStream.NextInstruction());
+    EXPECT_FALSE(instStream.NextInstruction());
+    EXPECT_TRUE(instStream.Failed());
+    EXPECT_EQ(instStream.GetOffset(), 2u);
+}
+
+TEST(CONTROL_FLOW_TEST, PackedKeepsPrefixAndFarPointer) {
+    const std::vector<u8> bytes = { 0xf2, 0xa7, 0xea, 0x78, 0x56, 0x34, 0x12 };
+    std::vector<PackedInstruction> packed;
+    ASSERT_TRUE(DecodePacked(ByteSpan{bytes.data(), bytes.size()}, packed));
+    ASSERT_EQ(packed.size(), 2u);
+
+    char str[MAX_INST_STR_LEN];
+    EXPECT_EQ(std::string(str, packed[0].Unpack().Format(str)), "repne cmpsw ");
+    EXPECT_EQ(std::string(str, packed[1].Unpack().Format(str)), "jmp 4660:22136");
+}
+
+TEST(CONTROL_FLOW_TEST, Labels) {
+    const std::vector<u8> bytes = {
+        0xb9, 0x03, 0x00, // mov cx, word 3
+        0x40,             // inc ax
+        0xe2, 0xfd,       // loop back to the inc
+        0x74, 0x03,       // je to the ret
+        0xe8, 0xf5, 0xff, // call the mov
+        0xc3,             // ret
+        0xeb, 0x10,       // jmp past the end
+        0x75, 0xfd,       // jne into the middle of the jmp
+    };
+    EXPECT_EQ(DisassembleLabels(bytes),
+        "label_0:\n"
+        "mov cx, word 3\n"
+        "label_1:\n"
+        "inc ax\n"
+        "loop label_1\n"
+        "je label_2\n"
+        "call label_0\n"
+        "label_2:\n"
+        "ret \n"
+        "jmp $+18\n"
+        "jne $-1\n");
+}
+
+TEST(CONTROL_FLOW_TEST, LabelsStopAtInvalidInstruction) {
+    const std::vector<u8> bytes = { 0xeb, 0xfe, 0x60 };
+    EXPECT_EQ(DisassembleLabels(bytes, false),
+        "label_0:\n"
+        "jmp label_0\n");
+}
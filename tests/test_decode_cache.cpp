@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include <dis86_decode_cache.h>
+#include <dis86_instruction_stream.h>
+#include "test_util.h"
+
+// decodes bytes with and without the cache, expecting the same instructions
+// at the same offsets
+static void ExpectSameWithCache(const std::vector<u8>& bytes, DecodeCache& cache) {
+    InstStream plain(ByteSpan{bytes.data(), bytes.size()});
+    InstStream cached(ByteSpan{bytes.data(), bytes.size()});
+    cached.SetDecodeCache(&cache);
+    while (true) {
+        Instruction expected = plain.NextInstruction();
+        Instruction actual = cached.NextInstruction();
+        ASSERT_EQ((bool)actual, (bool)expected) << "offset " << plain.GetOffset();
+        if (!expected) {
+            break;
+        }
+        ASSERT_TRUE(actual == expected) << "offset " << expected.GetOffset();
+        ASSERT_EQ(actual.GetOffset(), expected.GetOffset());
+        ASSERT_EQ(actual.GetLength(), expected.GetLength());
+        ASSERT_EQ(cached.GetInstBytes()[0], plain.GetInstBytes()[0]);
+    }
+    EXPECT_EQ(cached.Failed(), plain.Failed());
+    EXPECT_EQ(cached.GetOffset(), plain.GetOffset());
+}
+
+TEST(DECODE_CACHE_TEST, SameAsDecoding) {
+    std::vector<u8> file = ReadAsmFile("all_supported");
+    ASSERT_FALSE(file.empty());
+    std::vector<u8> bytes;
+    for (u32 i = 0; i < 4; i++) {
+        bytes.insert(bytes.end(), file.begin(), file.end());
+    }
+    // rep prefixed string ops, which are cached with their prefix
+    bytes.insert(bytes.end(), { 0xf3, 0xa4, 0xf2, 0xae, 0xf3, 0xa4, 0xa4 });
+
+    DecodeCache cache;
+    ExpectSameWithCache(bytes, cache);
+    // the file repeats, so everything after the first copy should hit
+    EXPECT_GE(cache.GetHits(), cache.GetMisses() * 2);
+
+    cache.ResetCounters();
+    EXPECT_EQ(cache.GetHits(), 0u);
+    EXPECT_EQ(cache.GetMisses(), 0u);
+}
+
+TEST(DECODE_CACHE_TEST, SameAsDecodingRandomBytes) {
+    // lots of distinct instructions sharing first bytes, with a cache small
+    // enough that entries keep getting replaced
+    std::mt19937 rng(8086);
+    DecodeCache cache(4);
+    for (u32 rep = 0; rep < 20; rep++) {
+        std::vector<u8> bytes(4096);
+        for (u8& byte : bytes) {
+            byte = (u8)(rng() % 4 == 0 ? rng() : 0x89);
+        }
+        ExpectSameWithCache(bytes, cache);
+    }
+}
+
+TEST(DECODE_CACHE_TEST, NoHitPastEndOfInput) {
+    DecodeCache cache;
+    const std::vector<u8> full = { 0xb8, 0x34, 0x12 }; // mov ax, word 4660
+    ExpectSameWithCache(full, cache);
+    EXPECT_EQ(cache.GetMisses(), 1u);
+
+    // the cached mov needs a byte that isn't there
+    const std::vector<u8> cut = { 0xb8, 0x34 };
+    InstStream instStream(ByteSpan{cut.data(), cut.size()});
+    instStream.SetDecodeCache(&cache);
+    EXPECT_FALSE(instStream.NextInstruction());
+    EXPECT_TRUE(instStream.Failed());
+    EXPECT_EQ(cache.GetHits(), 0u);
+}
+
+TEST(DECODE_CACHE_TEST, OneByteInstructionHitsWhateverFollows) {
+    DecodeCache cache;
+    // push bp, then a different instruction each time
+    const u8 nextBytes[] = { 0x40, 0x41, 0x48, 0x50, 0x90, 0xc3, 0x89, 0xb8 };
+    for (u8 next : nextBytes) {
+        const std::vector<u8> bytes = { 0x55, next, 0x00, 0x00 };
+        InstStream instStream(ByteSpan{bytes.data(), bytes.size()});
+        instStream.SetDecodeCache(&cache);
+        Instruction inst = instStream.NextInstruction();
+        ASSERT_TRUE(inst);
+        EXPECT_EQ(inst.GetLength(), 1);
+    }
+    EXPECT_EQ(cache.GetHits(), ARR_SIZE(nextBytes) - 1);
+}
+
+TEST(DECODE_CACHE_TEST, OneByteInstructionsAreOneByte) {
+    u32 numOneByte = 0;
+    for (u32 byte = 0; byte < 256; byte++) {
+        // the table has to agree with decoding whatever comes after
+        bool isOneByte = true;
+        bool decodes = false;
+        for (u32 next = 0; next < 256; next++) {
+            const std::vector<u8> bytes = { (u8)byte, (u8)next, 0, 0, 0, 0, 0, 0 };
+            InstStream instStream(ByteSpan{bytes.data(), bytes.size()});
+            Instruction inst = instStream.NextInstruction();
+            decodes = decodes || inst;
+            isOneByte = isOneByte && inst && inst.GetLength() == 1;
+        }
+        EXPECT_EQ(InstFormats::IsOneByteInstruction((u8)byte), decodes && isOneByte)
+            << "byte " << byte;
+        numOneByte += InstFormats::IsOneByteInstruction((u8)byte);
+    }
+    // push/pop/inc/dec reg, xchg ax, string ops and the like
+    EXPECT_GT(numOneByte, 64u);
+}
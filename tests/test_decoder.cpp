@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <dis86_instruction_stream.h>
+
+static Instruction DecodeFirst(const std::string& bytes, bool linear) {
+    std::istringstream byteStream(bytes);
+    InstStream instStream(&byteStream);
+    return linear ? instStream.NextInstructionLinear() : instStream.NextInstruction();
+}
+
+// the compile-time decoders must give the same result as the runtime
+// interpreter for every first two bytes, followed by a few different tails
+// (8086 instructions are at most 6 bytes long)
+TEST(DECODER_TEST, GeneratedMatchesInterpreter) {
+    std::mt19937 rng(8086);
+    for (u32 opByte = 0; opByte < 256; opByte++) {
+        for (u32 secondByte = 0; secondByte < 256; secondByte++) {
+            for (u32 tail = 0; tail < 3; tail++) {
+                std::string bytes = { (char)opByte, (char)secondByte };
+                for (u32 i = 0; i < 4; i++) {
+                    bytes += (char)(tail == 0 ? 0x00 : tail == 1 ? 0xff : rng());
+                }
+
+                Instruction reference = DecodeFirst(bytes, true);
+                Instruction generated = DecodeFirst(bytes, false);
+                ASSERT_EQ((bool)reference, (bool)generated)
+                    << "bytes " << opByte << " " << secondByte;
+                ASSERT_EQ(reference, generated)
+                    << "bytes " << opByte << " " << secondByte;
+            }
+        }
+    }
+}
@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <dis86_inst_file.h>
+#include <dis86_instruction_stream.h>
+#include <dis86_parallel.h>
+#include "test_util.h"
+
+// the image as dis86 --format bin writes it
+static void WriteInstFile(ByteSpan image, OutputBuffer& out) {
+    WriteInstFileHeader(out);
+    InstStream instStream(image);
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        inst.Format(out, OutputFormat::BINARY, instStream.GetInstBytes());
+    }
+    ASSERT_FALSE(instStream.Failed());
+}
+
+static ByteSpan GetBytes(const OutputBuffer& out) {
+    return ByteSpan{(const u8 *)out.Data(), out.Size()};
+}
+
+TEST(INST_FILE_TEST, RoundTrips) {
+    const char *files[] = {
+        "acc2mem", "add", "all_supported", "imm2rm", "push_pop",
+        "rm2reg", "shift", "xchg_in_out", "xlat_lea_lds_les",
+    };
+    for (const char *name : files) {
+        std::vector<u8> bytes = ReadAsmFile(name);
+        ASSERT_FALSE(bytes.empty()) << name;
+        ByteSpan image = {bytes.data(), bytes.size()};
+
+        OutputBuffer out;
+        WriteInstFile(image, out);
+        InstFileReader reader;
+        ASSERT_TRUE(reader.Open(GetBytes(out))) << name;
+
+        InstStream instStream(image);
+        u64 idx = 0;
+        Instruction expected;
+        while (expected = instStream.NextInstruction()) {
+            ASSERT_LT(idx, reader.GetNumInsts()) << name;
+            Instruction inst;
+            ASSERT_TRUE(reader.GetInst(idx, inst)) << name << " instruction index:" << idx;
+            EXPECT_EQ(inst, expected) << name << " instruction index:" << idx;
+            EXPECT_EQ(inst.GetOffset(), expected.GetOffset());
+            EXPECT_EQ(inst.GetLength(), expected.GetLength());
+            // operator== ignores memory operand widths, the text doesn't
+            char expectedStr[MAX_INST_STR_LEN], str[MAX_INST_STR_LEN];
+            EXPECT_EQ(std::string(str, inst.Format(str)),
+                      std::string(expectedStr, expected.Format(expectedStr)));
+            idx++;
+        }
+        EXPECT_EQ(reader.GetNumInsts(), idx) << name;
+    }
+}
+
+TEST(INST_FILE_TEST, RandomAccessFromMappedFile) {
+    std::vector<u8> bytes = ReadAsmFile("all_supported");
+    ByteSpan image = {bytes.data(), bytes.size()};
+    std::vector<Instruction> expected;
+    InstStream instStream(image);
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        expected.push_back(inst);
+    }
+
+    OutputBuffer out;
+    WriteInstFile(image, out);
+    std::string path = testing::TempDir() + "dis86_inst_file_test.insts";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(out.Data(), out.Size());
+    }
+
+    InstFileReader reader;
+    ASSERT_TRUE(reader.Open(path.c_str()));
+    ASSERT_EQ(reader.GetNumInsts(), expected.size());
+    // back to front, each record is found from its index alone
+    for (u64 i = expected.size(); i-- > 0;) {
+        ASSERT_TRUE(reader.GetInst(i, inst));
+        EXPECT_EQ(inst, expected[i]) << "instruction index:" << i;
+        EXPECT_EQ(inst.GetOffset(), expected[i].GetOffset());
+    }
+    std::remove(path.c_str());
+
+    EXPECT_FALSE(reader.Open(path.c_str()));
+    EXPECT_EQ(reader.GetNumInsts(), 0u);
+}
+
+TEST(INST_FILE_TEST, KeepsFarPointersAndPrefixes) {
+    Instruction jmpFar(OpType::JMP, Operand::MakeFarPointer(0x1234, 0xfedc), {});
+    jmpFar.SetLocation(0x123456789, 5);
+    Instruction repMovsb(OpType::MOVSB, {}, {});
+    repMovsb.SetLocation(7, 2);
+    repMovsb.SetPrefix(RepPrefix::REP);
+
+    OutputBuffer out;
+    WriteInstFileHeader(out);
+    WriteInstRecord(out, jmpFar);
+    WriteInstRecord(out, repMovsb);
+    InstFileReader reader;
+    ASSERT_TRUE(reader.Open(GetBytes(out)));
+    ASSERT_EQ(reader.GetNumInsts(), 2u);
+
+    Instruction inst;
+    ASSERT_TRUE(reader.GetInst(0, inst));
+    EXPECT_EQ(inst, jmpFar);
+    EXPECT_EQ(inst.GetOperand(0).farPointer.segment, 0x1234);
+    EXPECT_EQ(inst.GetOperand(0).farPointer.offset, 0xfedc);
+    EXPECT_EQ(inst.GetOffset(), 0x123456789u);
+    ASSERT_TRUE(reader.GetInst(1, inst));
+    EXPECT_EQ(inst, repMovsb);
+    EXPECT_EQ(inst.GetPrefix(), RepPrefix::REP);
+}
+
+TEST(INST_FILE_TEST, RejectsMalformedFiles) {
+    std::vector<u8> bytes = ReadAsmFile("rm2reg");
+    OutputBuffer out;
+    WriteInstFile(ByteSpan{bytes.data(), bytes.size()}, out);
+    std::vector<u8> file(GetBytes(out).data, GetBytes(out).data + out.Size());
+    InstFileReader reader;
+    ASSERT_TRUE(reader.Open(ByteSpan{file.data(), file.size()}));
+    ASSERT_GT(reader.GetNumInsts(), 1u);
+
+    // a header alone is an empty file, less than that is not a file at all
+    EXPECT_TRUE(reader.Open(ByteSpan{file.data(), INST_FILE_HEADER_BYTES}));
+    EXPECT_EQ(reader.GetNumInsts(), 0u);
+    EXPECT_FALSE(reader.Open(ByteSpan{file.data(), INST_FILE_HEADER_BYTES - 1}));
+    // cut off part way through a record
+    EXPECT_FALSE(reader.Open(ByteSpan{file.data(), file.size() - 1}));
+
+    for (u64 headerByte : {0, 4, 8}) {
+        std::vector<u8> bad = file;
+        bad[headerByte]++;
+        EXPECT_FALSE(reader.Open(ByteSpan{bad.data(), bad.size()})) << headerByte;
+        EXPECT_EQ(reader.GetNumInsts(), 0u);
+    }
+
+    // bad records are caught when read, the rest can still be used
+    std::vector<u8> bad = file;
+    u8 *record = bad.data() + INST_FILE_HEADER_BYTES;
+    record[8] = (u8)OpType::NUM_OPS;
+    ASSERT_TRUE(reader.Open(ByteSpan{bad.data(), bad.size()}));
+    Instruction inst;
+    EXPECT_FALSE(reader.GetInst(0, inst));
+    EXPECT_TRUE(reader.GetInst(1, inst));
+
+    bad = file;
+    record = bad.data() + INST_FILE_HEADER_BYTES;
+    record[10] = (u8)OperandType::REGISTER | (8 << 4);
+    ASSERT_TRUE(reader.Open(ByteSpan{bad.data(), bad.size()}));
+    EXPECT_FALSE(reader.GetInst(0, inst));
+}
+
+TEST(INST_FILE_TEST, ParallelWritesTheSameRecords) {
+    std::vector<u8> bytes = ReadAsmFile("all_supported");
+    ByteSpan image = {bytes.data(), bytes.size()};
+    OutputBuffer expected;
+    WriteInstFile(image, expected);
+
+    // small chunks so most of them start mid-instruction
+    OutputBuffer out;
+    WriteInstFileHeader(out);
+    ASSERT_TRUE(DisassembleParallel(image, 4, out, 16, OutputFormat::BINARY));
+    EXPECT_EQ(std::string(out.Data(), out.Size()),
+              std::string(expected.Data(), expected.Size()));
+}
@@ -0,0 +1,23 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <dis86.h>
+
+// only the public header, the way a program linking dis86_core would use it
+TEST(LIBRARY_TEST, DecodesThroughPublicHeader) {
+    const std::vector<u8> code = {
+        0x89, 0xd9,       // mov cx, bx
+        0xb8, 0x2a, 0x00, // mov ax, word 42
+    };
+    InstStream instStream(ByteSpan{code.data(), code.size()});
+    OutputBuffer out;
+    Instruction inst;
+    std::vector<u64> offsets;
+    while (inst = instStream.NextInstruction()) {
+        offsets.push_back(inst.GetOffset());
+        inst.Format(out);
+    }
+    EXPECT_FALSE(instStream.Failed());
+    EXPECT_EQ(offsets, (std::vector<u64>{ 0, 2 }));
+    EXPECT_EQ(std::string(out.Data(), out.Size()), "mov cx, bx\nmov ax, word 42\n");
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <dis86_batch.h>
+#include "test_util.h"
+
+static const char *asmFiles[] = { "acc2mem", "add", "all_supported", "imm2rm", "push_pop" };
+
+static std::vector<std::string> AsmPaths(u32 copies) {
+    std::vector<std::string> paths;
+    for (u32 i = 0; i < copies; i++) {
+        for (const char *name : asmFiles) {
+            paths.push_back(GetAsmPath(name));
+        }
+    }
+    return paths;
+}
+
+// what the batch should write for path on its own
+static std::string DisassembleOne(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    InstStream instStream(&file);
+    OutputBuffer out;
+    DisassembleText(ByteSpan{}, instStream, out);
+    return std::string(out.Data(), out.Size());
+}
+
+TEST(MULTI_FILE_TEST, ConcatenatesInInputOrder) {
+    std::vector<std::string> paths = AsmPaths(20);
+    std::string expected;
+    for (const std::string& path : paths) {
+        expected += "; file " + path + "\n" + DisassembleOne(path);
+    }
+
+    for (u32 numThreads : { 1, 3, 8 }) {
+        BatchOptions options;
+        options.numThreads = numThreads;
+        std::ostringstream out;
+        BatchStats stats = DisassembleBatch(paths, options, out, DisassembleText);
+        EXPECT_EQ(out.str(), expected) << numThreads << " threads";
+        EXPECT_EQ(stats.numFiles, paths.size());
+        EXPECT_EQ(stats.numFailed, 0u);
+    }
+}
+
+TEST(MULTI_FILE_TEST, OneOutputPerInput) {
+    std::filesystem::path outDir = std::filesystem::temp_directory_path() / "dis86_multi_file_test";
+    std::filesystem::remove_all(outDir);
+    std::filesystem::create_directories(outDir);
+    std::string outDirStr = outDir.string();
+
+    BatchOptions options;
+    options.numThreads = 4;
+    options.outDir = outDirStr.c_str();
+    std::ostringstream out;
+    std::vector<std::string> paths = AsmPaths(1);
+    BatchStats stats = DisassembleBatch(paths, options, out, DisassembleText);
+    EXPECT_EQ(stats.numFailed, 0u);
+    EXPECT_TRUE(out.str().empty());
+
+    u64 numBytes = 0;
+    for (const std::string& path : paths) {
+        std::ifstream outFile(outDir / (std::filesystem::path(path).filename().string() + ".asm"),
+                              std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(outFile)),
+                         std::istreambuf_iterator<char>());
+        EXPECT_EQ(text, DisassembleOne(path)) << path;
+        numBytes += std::filesystem::file_size(path);
+    }
+    EXPECT_EQ(stats.numBytes, numBytes);
+    std::filesystem::remove_all(outDir);
+}
+
+TEST(MULTI_FILE_TEST, SameNamesFromDifferentDirectories) {
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "dis86_same_names_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::path outDir = root / "out";
+    std::filesystem::create_directories(outDir);
+    // a/x and b/x with different code, and an input named like the
+    // renamed output of the second x
+    const char *inputs[][2] = { { "a", "add" }, { "b", "shift" }, { "c", "push_pop" } };
+    const char *inputNames[] = { "x", "x", "1_x" };
+    std::vector<std::string> paths;
+    for (u32 i = 0; i < ARR_SIZE(inputs); i++) {
+        std::filesystem::create_directories(root / inputs[i][0]);
+        std::filesystem::path path = root / inputs[i][0] / inputNames[i];
+        std::filesystem::copy_file(GetAsmPath(inputs[i][1]), path);
+        paths.push_back(path.string());
+    }
+    std::string outDirStr = outDir.string();
+
+    BatchOptions options;
+    options.numThreads = 3;
+    options.outDir = outDirStr.c_str();
+    std::ostringstream out;
+    BatchStats stats = DisassembleBatch(paths, options, out, DisassembleText);
+    EXPECT_EQ(stats.numFailed, 0u);
+
+    // every input has its own output, none was written over
+    std::vector<std::string> texts;
+    for (const auto& entry : std::filesystem::directory_iterator(outDir)) {
+        std::ifstream outFile(entry.path(), std::ios::binary);
+        texts.emplace_back(std::istreambuf_iterator<char>(outFile),
+                           std::istreambuf_iterator<char>());
+    }
+    ASSERT_EQ(texts.size(), paths.size());
+    for (const std::string& path : paths) {
+        EXPECT_EQ(std::count(texts.begin(), texts.end(), DisassembleOne(path)), 1) << path;
+    }
+    std::filesystem::remove_all(root);
+}
+
+TEST(MULTI_FILE_TEST, MissingFilesFailWithoutStopping) {
+    std::vector<std::string> paths = AsmPaths(1);
+    paths.insert(paths.begin() + 2, DIS86_ASM_DIR "/does_not_exist");
+
+    BatchOptions options;
+    options.numThreads = 2;
+    std::ostringstream out;
+    BatchStats stats = DisassembleBatch(paths, options, out, DisassembleText);
+    EXPECT_EQ(stats.numFiles, paths.size());
+    EXPECT_EQ(stats.numFailed, 1u);
+    // the missing file still gets its header, the others their text
+    EXPECT_NE(out.str().find("; file " DIS86_ASM_DIR "/does_not_exist\n; file "), std::string::npos);
+    EXPECT_NE(out.str().find(DisassembleOne(paths.back())), std::string::npos);
+}
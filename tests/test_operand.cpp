@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <climits>
+#include <string>
+#include <dis86_operand.h>
+
+static std::string FormatIntStr(i32 val) {
+    char str[16];
+    return std::string(str, FormatInt(str, val));
+}
+
+TEST(OPERAND_TEST, FormatIntMatchesToString) {
+    for (i32 val = -70000; val <= 70000; val++) {
+        ASSERT_EQ(FormatIntStr(val), std::to_string(val));
+    }
+    for (i32 val : { 999999, 1000000, 123456789, 1000000000, INT_MAX, INT_MIN, INT_MIN + 1 }) {
+        EXPECT_EQ(FormatIntStr(val), std::to_string(val));
+    }
+}
+
+TEST(OPERAND_TEST, FormatsEveryRegisterAndAddress) {
+    const char *wordRegs[] = { "ax", "cx", "dx", "bx", "sp", "bp", "si", "di" };
+    const char *byteRegs[] = { "al", "cl", "dl", "bl", "ah", "ch", "dh", "bh" };
+    for (u8 i = 0; i < 8; i++) {
+        EXPECT_EQ(Operand::Make(OperandType::REGISTER, i, true, 0).GetStr(), wordRegs[i]);
+        EXPECT_EQ(Operand::Make(OperandType::REGISTER, i, false, 0).GetStr(), byteRegs[i]);
+    }
+    EXPECT_EQ(Operand::Make(OperandType::SEG_REG, 2, false, 0).GetStr(), "ss");
+
+    const char *exps[] = { "bx + si", "bx + di", "bp + si", "bp + di", "si", "di", "bp", "bx" };
+    for (u8 i = 0; i < 8; i++) {
+        std::string exp = exps[i];
+        EXPECT_EQ(Operand::Make(OperandType::MEMORY, i, true, 0).GetStr(), "[" + exp + "]");
+        EXPECT_EQ(Operand::Make(OperandType::MEMORY, i, true, 12).GetStr(), "[" + exp + " + 12]");
+        EXPECT_EQ(Operand::Make(OperandType::MEMORY, i, true, (u16)-32768).GetStr(),
+                  "[" + exp + " - 32768]");
+    }
+    EXPECT_EQ(Operand::Make(OperandType::MEMORY, 8, true, 1000).GetStr(), "[1000]");
+    EXPECT_EQ(Operand::Make(OperandType::IMMEDIATE, 0, true, (u16)-5).GetStr(), "word -5");
+    EXPECT_EQ(Operand::MakeFarPointer(0xf000, 0xfff0).GetStr(), "61440:65520");
+}
+
+TEST(OPERAND_TEST, TryMakeChecksIndexes) {
+    Operand op;
+    EXPECT_TRUE(Operand::TryMake(OperandType::REGISTER, 7, false, 0, 0, op));
+    EXPECT_EQ(op, Operand::Make(OperandType::REGISTER, 7, false, 0));
+    EXPECT_FALSE(Operand::TryMake(OperandType::REGISTER, 8, false, 0, 0, op));
+    EXPECT_TRUE(Operand::TryMake(OperandType::SEG_REG, 3, false, 0, 0, op));
+    EXPECT_FALSE(Operand::TryMake(OperandType::SEG_REG, 4, false, 0, 0, op));
+    EXPECT_TRUE(Operand::TryMake(OperandType::MEMORY, 8, true, 1000, 0, op));
+    EXPECT_EQ(op.GetStr(), "[1000]");
+    EXPECT_FALSE(Operand::TryMake(OperandType::MEMORY, 9, true, 1000, 0, op));
+    // a far pointer takes its segment from the extra value
+    EXPECT_TRUE(Operand::TryMake(OperandType::FAR_POINTER, 0, false, 0xfff0, 0xf000, op));
+    EXPECT_EQ(op.GetStr(), "61440:65520");
+    EXPECT_FALSE(Operand::TryMake((OperandType)7, 0, false, 0, 0, op));
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <dis86_instruction_stream.h>
+#include <dis86_output_buffer.h>
+#include "test_util.h"
+
+// counts the writes that reach it
+class CountingStringBuf : public std::stringbuf {
+public:
+    u32 numWrites = 0;
+
+protected:
+    std::streamsize xsputn(const char *str, std::streamsize len) override {
+        numWrites++;
+        return std::stringbuf::xsputn(str, len);
+    }
+};
+
+TEST(OUTPUT_BUFFER_TEST, FlushesToSinkWhenFull) {
+    CountingStringBuf buf;
+    std::ostream sink(&buf);
+    std::string expected;
+    {
+        OutputBuffer out(&sink, 16);
+        for (u32 i = 0; i < 10; i++) {
+            std::string line = "line " + std::to_string(i) + "\n";
+            out.Write(line.data(), line.size());
+            expected += line;
+            // never more than a block held back
+            EXPECT_LE(out.Size(), 16u);
+        }
+        EXPECT_GT(buf.numWrites, 0u);
+        EXPECT_EQ(buf.str() + std::string(out.Data(), out.Size()), expected);
+    }
+    // the rest goes out on destruction
+    EXPECT_EQ(buf.str(), expected);
+}
+
+TEST(OUTPUT_BUFFER_TEST, ReserveLargerThanBlockWithSink) {
+    std::ostringstream sink;
+    OutputBuffer out(&sink, 8);
+    out.Write("abc", 3);
+
+    std::string big(100, 'x');
+    char *bytes = out.Reserve(big.size());
+    // what was held is written out before the block grows
+    EXPECT_EQ(sink.str(), "abc");
+    std::copy(big.begin(), big.end(), bytes);
+    out.Commit(bytes + big.size());
+    EXPECT_EQ(std::string(out.Data(), out.Size()), big);
+
+    out.Flush();
+    EXPECT_EQ(out.Size(), 0u);
+    EXPECT_EQ(sink.str(), "abc" + big);
+}
+
+TEST(OUTPUT_BUFFER_TEST, GrowsWithoutSink) {
+    OutputBuffer out;
+    std::string expected;
+    for (u32 i = 0; i < 1000; i++) {
+        std::string line = std::to_string(i) + ",";
+        out.Write(line.data(), line.size());
+        expected += line;
+    }
+    EXPECT_GT(out.Size(), 1024u);
+    EXPECT_EQ(std::string(out.Data(), out.Size()), expected);
+
+    // flushing without a sink keeps the text
+    out.Flush();
+    EXPECT_EQ(out.Size(), expected.size());
+    out.Clear();
+    EXPECT_EQ(out.Size(), 0u);
+    out.Write("after", 5);
+    EXPECT_EQ(std::string(out.Data(), out.Size()), "after");
+}
+
+TEST(OUTPUT_BUFFER_TEST, CallerOwnedBlock) {
+    char block[32];
+    std::ostringstream sink;
+    {
+        OutputBuffer out(block, sizeof(block), &sink);
+        out.Write("mov ax, bx\n", 11);
+        EXPECT_EQ(out.Data(), block);
+        out.Clear();
+        out.Write("nop\n", 4);
+    }
+    // cleared text is never written
+    EXPECT_EQ(sink.str(), "nop\n");
+}
+
+// the .txt files next to the inputs were written by dis86 before it had an
+// OutputBuffer, when Print built each line out of std::strings. random_mix is
+// random bytes with whatever didn't decode as a whole instruction taken out.
+TEST(OUTPUT_BUFFER_TEST, FormatMatchesGoldenText) {
+    for (const char *name : { "all_supported", "random_mix" }) {
+        std::vector<u8> bytes = ReadAsmFile(name);
+        ASSERT_FALSE(bytes.empty()) << name;
+
+        // a small block so the text crosses many flushes
+        std::ostringstream formatted;
+        {
+            OutputBuffer out(&formatted, 256);
+            InstStream instStream(ByteSpan{bytes.data(), bytes.size()});
+            Instruction inst;
+            while (inst = instStream.NextInstruction()) {
+                inst.Format(out);
+            }
+            ASSERT_FALSE(instStream.Failed()) << name;
+        }
+
+        // line by line so a mismatch names the instruction
+        std::istringstream formattedLines(formatted.str());
+        std::istringstream goldenLines(ReadAsmString((std::string(name) + ".txt").c_str()));
+        std::string formattedLine, goldenLine;
+        u64 numLines = 0;
+        while (std::getline(goldenLines, goldenLine)) {
+            ASSERT_TRUE(std::getline(formattedLines, formattedLine)) << name;
+            ASSERT_EQ(formattedLine, goldenLine) << name << " instruction index:" << numLines;
+            numLines++;
+        }
+        EXPECT_FALSE(std::getline(formattedLines, formattedLine)) << name;
+        EXPECT_GT(numLines, 100u) << name;
+    }
+}
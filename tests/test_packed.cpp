@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <dis86_instruction_stream.h>
+#include <dis86_packed_instruction.h>
+#include "test_util.h"
+
+static_assert(sizeof(PackedInstruction) == 8, "PackedInstruction is not 8 bytes");
+static_assert(sizeof(PackedInstruction) < sizeof(Instruction), "PackedInstruction is not smaller");
+
+TEST(PACKED_TEST, RoundTrips) {
+    const char *files[] = {
+        "acc2mem", "add", "all_supported", "imm2rm", "push_pop",
+        "rm2reg", "shift", "xchg_in_out", "xlat_lea_lds_les",
+    };
+    for (const char *name : files) {
+        std::vector<u8> bytes = ReadAsmFile(name);
+        ASSERT_FALSE(bytes.empty()) << name;
+        ByteSpan span = {bytes.data(), bytes.size()};
+
+        std::vector<PackedInstruction> packed;
+        ASSERT_TRUE(DecodePacked(span, packed)) << name;
+
+        InstStream instStream(span);
+        for (u64 i = 0; i < packed.size(); i++) {
+            Instruction inst = instStream.NextInstruction();
+            ASSERT_TRUE(inst);
+            EXPECT_EQ(packed[i].GetOpType(), inst.GetOpType());
+            EXPECT_EQ(packed[i], PackedInstruction(inst));
+            Instruction unpacked = packed[i].Unpack();
+            EXPECT_EQ(unpacked, inst) << name << " instruction index:" << i;
+            // operator== ignores memory operand widths, the text doesn't
+            char expectedStr[MAX_INST_STR_LEN], str[MAX_INST_STR_LEN];
+            EXPECT_EQ(std::string(str, unpacked.Format(str)),
+                      std::string(expectedStr, inst.Format(expectedStr)));
+            for (u32 j = 0; j < 2; j++) {
+                EXPECT_EQ(packed[i].GetOperandType(j), inst.GetOperand(j).operandType);
+                EXPECT_EQ(packed[i].GetOperand(j), inst.GetOperand(j));
+            }
+        }
+        EXPECT_FALSE(instStream.NextInstruction());
+    }
+}
+
+TEST(PACKED_TEST, KeepsBothValues) {
+    // mov word [bx + di - 2], -32768
+    Operand dest = Operand::Make(OperandType::MEMORY, (u8)AddressExpIdx::BX_DI, true, (u16)-2);
+    Operand src = Operand::Make(OperandType::IMMEDIATE, 0, true, 0x8000);
+    Instruction inst(OpType::MOV, dest, src);
+
+    PackedInstruction packed(inst);
+    char expectedStr[MAX_INST_STR_LEN], str[MAX_INST_STR_LEN];
+    Instruction unpacked = packed.Unpack();
+    EXPECT_EQ(std::string(str, unpacked.Format(str)),
+              std::string(expectedStr, inst.Format(expectedStr)));
+    EXPECT_EQ(unpacked.GetOperand(0).address.disp, -2);
+    EXPECT_EQ(unpacked.GetOperand(1).immediate.immU16, 0x8000);
+}
+
+TEST(PACKED_TEST, DefaultIsEmpty) {
+    PackedInstruction packed;
+    EXPECT_FALSE(packed);
+    EXPECT_FALSE(packed.Unpack());
+}
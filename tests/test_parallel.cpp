@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include <dis86_instruction_stream.h>
+#include <dis86_parallel.h>
+
+// random stream of valid instructions, each one is found by decoding random
+// bytes and keeping the shortest prefix that decodes
+static std::vector<u8> MakeRandomCode(u32 seed, u32 size) {
+    std::mt19937 rng(seed);
+    std::vector<u8> code;
+    while (code.size() < size) {
+        u8 bytes[MAX_INST_BYTES];
+        for (u8& byte : bytes) {
+            byte = (u8)rng();
+        }
+        for (u32 len = 1; len <= MAX_INST_BYTES; len++) {
+            InstStream instStream(ByteSpan{bytes, len});
+            if (instStream.NextInstruction()) {
+                code.insert(code.end(), bytes, bytes + len);
+                break;
+            }
+        }
+    }
+    return code;
+}
+
+static bool DisassembleSequential(const std::vector<u8>& image, OutputFormat format,
+                                  std::string& text) {
+    OutputBuffer out;
+    InstStream instStream(ByteSpan{image.data(), image.size()});
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        inst.Format(out, format, instStream.GetInstBytes());
+    }
+    text.assign(out.Data(), out.Size());
+    return !instStream.Failed();
+}
+
+static void ExpectSameAsSequential(const std::vector<u8>& image,
+                                   OutputFormat format = OutputFormat::TEXT) {
+    std::string expected;
+    bool expectedOk = DisassembleSequential(image, format, expected);
+
+    for (u32 numThreads : {1, 2, 3, 8}) {
+        for (u32 chunkSize : {6, 7, 13, 64, 1000, 1 << 20}) {
+            OutputBuffer out;
+            bool ok = DisassembleParallel(ByteSpan{image.data(), image.size()},
+                numThreads, out, chunkSize, format);
+            EXPECT_EQ(ok, expectedOk)
+                << numThreads << " threads, chunk size " << chunkSize;
+            ASSERT_EQ(std::string(out.Data(), out.Size()), expected)
+                << numThreads << " threads, chunk size " << chunkSize;
+        }
+    }
+}
+
+TEST(PARALLEL_TEST, MatchesSequential) {
+    ExpectSameAsSequential(MakeRandomCode(1, 20000));
+    ExpectSameAsSequential(MakeRandomCode(2, 777));
+    ExpectSameAsSequential({});
+}
+
+TEST(PARALLEL_TEST, ListingMatchesSequential) {
+    ExpectSameAsSequential(MakeRandomCode(5, 5000), OutputFormat::LISTING);
+}
+
+TEST(PARALLEL_TEST, StopsAtInvalidInstruction) {
+    std::vector<u8> image = MakeRandomCode(3, 10000);
+    // 0x60 is not an 8086 opcode
+    image.insert(image.begin() + image.size() / 2, 0x60);
+    image.insert(image.begin() + image.size() / 2, 0x60);
+    ExpectSameAsSequential(image);
+}
+
+TEST(PARALLEL_TEST, TruncatedLastInstruction) {
+    std::vector<u8> image = MakeRandomCode(4, 5000);
+    // mov [imm16], imm16 missing its last bytes
+    image.insert(image.end(), { 0xc7, 0x06, 0x00 });
+    ExpectSameAsSequential(image);
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <iterator>
+#include <random>
+#include <vector>
+#include <dis86_inst_format.h>
+#include <dis86_instruction_stream.h>
+#include <dis86_scan.h>
+#include "test_util.h"
+
+static const ScanIsa isas[] = { ScanIsa::SCALAR, ScanIsa::SSSE3, ScanIsa::AVX2 };
+
+TEST(SCAN_TEST, EveryIsaMatchesScalar) {
+    std::mt19937 rng(8086);
+    std::vector<u8> bytes(100000);
+    for (u8& byte : bytes) {
+        // a small alphabet so patterns match often
+        byte = (u8)(rng() % 6) + 0x8a;
+    }
+    std::vector<std::vector<u8>> patterns = {
+        { 0x8b }, { 0x8b, 0x8c }, { 0x8a, 0x8b, 0x8c, 0x8d }, {}, { 0xff },
+    };
+
+    // sizes that end part way through a vector and a bitmap word
+    for (u64 size : { (u64)0, (u64)1, (u64)63, (u64)64, (u64)100, (u64)4099, (u64)bytes.size() }) {
+        ByteSpan image = {bytes.data(), size};
+        ScanResult expected;
+        ScanImage(image, patterns, expected, ScanIsa::SCALAR);
+        for (ScanIsa isa : isas) {
+            if (!IsScanIsaSupported(isa)) {
+                continue;
+            }
+            ScanResult result;
+            ScanImage(image, patterns, result, isa);
+            EXPECT_EQ(result.histogram, expected.histogram) << GetScanIsaName(isa) << " " << size;
+            EXPECT_EQ(result.validStarts, expected.validStarts) << GetScanIsaName(isa) << " " << size;
+            EXPECT_EQ(result.numValidStarts, expected.numValidStarts) << GetScanIsaName(isa);
+            EXPECT_EQ(result.matches, expected.matches) << GetScanIsaName(isa) << " " << size;
+        }
+    }
+}
+
+TEST(SCAN_TEST, ValidStartsAndHistogram) {
+    std::vector<u8> bytes(256 * 3);
+    for (u32 i = 0; i < bytes.size(); i++) {
+        bytes[i] = (u8)i;
+    }
+    ScanResult result;
+    ScanImage(ByteSpan{bytes.data(), bytes.size()}, {}, result);
+    u64 numValid = 0;
+    for (u32 i = 0; i < bytes.size(); i++) {
+        EXPECT_EQ(result.IsValidStart(i), InstFormats::CanStartInstruction(bytes[i])) << i;
+        numValid += result.IsValidStart(i);
+    }
+    EXPECT_EQ(result.numValidStarts, numValid);
+    for (u64 count : result.histogram) {
+        EXPECT_EQ(count, 3u);
+    }
+    EXPECT_TRUE(InstFormats::CanStartInstruction(0x89));
+    EXPECT_TRUE(InstFormats::CanStartInstruction(0xf3));
+    EXPECT_FALSE(InstFormats::CanStartInstruction(0x60));
+
+    // every instruction the decoder finds starts on a valid start
+    std::vector<u8> file = ReadAsmFile("all_supported");
+    ScanImage(ByteSpan{file.data(), file.size()}, {}, result);
+    InstStream instStream(ByteSpan{file.data(), file.size()});
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        EXPECT_TRUE(result.IsValidStart(inst.GetOffset())) << inst.GetOffset();
+    }
+}
+
+TEST(SCAN_TEST, Patterns) {
+    std::vector<u8> bytes(200, 0x90);
+    for (u64 offset : { 0, 10, 13, 150, 197 }) {
+        bytes[offset] = 0x55;
+        bytes[offset + 1] = 0x8b;
+        bytes[offset + 2] = 0xec;
+    }
+    bytes[50] = 0x55; // first and last byte only
+    bytes[52] = 0xec;
+    std::vector<std::vector<u8>> patterns = { { 0x55, 0x8b, 0xec }, { 0x90, 0x90 } };
+    for (ScanIsa isa : isas) {
+        if (!IsScanIsaSupported(isa)) {
+            continue;
+        }
+        ScanResult result;
+        ScanImage(ByteSpan{bytes.data(), bytes.size()}, patterns, result, isa);
+        ASSERT_EQ(result.matches.size(), 2u);
+        EXPECT_EQ(result.matches[0], (std::vector<u64>{ 0, 10, 13, 150, 197 })) << GetScanIsaName(isa);
+        // overlapping matches all count
+        EXPECT_EQ(result.matches[1].front(), 3u);
+        EXPECT_EQ(result.matches[1][1], 4u);
+    }
+}
@@ -0,0 +1,268 @@
+#ifndef _WIN32
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <dis86_server.h>
+#include "test_util.h"
+
+static std::string Disassemble(const std::vector<u8>& code) {
+    InstStream instStream(ByteSpan{code.data(), code.size()});
+    OutputBuffer out;
+    DisassembleText(ByteSpan{}, instStream, out);
+    return std::string(out.Data(), out.Size());
+}
+
+static std::string ReadFileString(const std::string& path) {
+    std::ifstream file(path);
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+// how long the test server waits on a request that stopped arriving
+#define STALL_TIMEOUT_MS 200
+#define NUM_TEST_WORKERS 3
+
+// a connection that sends whatever the test wants, -1 if it can't connect
+static int ConnectRaw(const std::string& socketPath) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (sockaddr *)&address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// a server running on its own thread for the length of a test
+class ServerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        socketPath = (std::filesystem::temp_directory_path() /
+                      ("dis86_test_" + std::to_string(getpid()) + ".sock")).string();
+        ServerOptions options;
+        options.socketPath = socketPath.c_str();
+        options.numWorkers = NUM_TEST_WORKERS;
+        options.maxRequestSize = 64 * 1024;
+        options.requestTimeoutMs = STALL_TIMEOUT_MS;
+        server.reset(new Server(options, DisassembleText));
+        ASSERT_TRUE(server->Start());
+        serverThread = std::thread(&Server::Run, server.get());
+    }
+
+    void TearDown() override {
+        server->Stop();
+        serverThread.join();
+        server.reset();
+        EXPECT_FALSE(std::filesystem::exists(socketPath));
+    }
+
+    std::string socketPath;
+    std::unique_ptr<Server> server;
+    std::thread serverThread;
+};
+
+TEST_F(ServerTest, RepliesWithDisassembly) {
+    Client client;
+    ASSERT_TRUE(client.Connect(socketPath.c_str()));
+    // several requests on one connection, including an empty one
+    for (const char *name : { "add", "all_supported", "push_pop" }) {
+        std::vector<u8> code = ReadAsmFile(name);
+        ServerStatus status;
+        std::string text;
+        ASSERT_TRUE(client.Disassemble(ByteSpan{code.data(), code.size()}, status, text));
+        EXPECT_EQ(status, ServerStatus::OK);
+        EXPECT_EQ(text, Disassemble(code)) << name;
+    }
+    ServerStatus status;
+    std::string text;
+    ASSERT_TRUE(client.Disassemble(ByteSpan{}, status, text));
+    EXPECT_EQ(status, ServerStatus::OK);
+    EXPECT_TRUE(text.empty());
+}
+
+TEST_F(ServerTest, DecodeFailureAndTooLarge) {
+    Client client;
+    ASSERT_TRUE(client.Connect(socketPath.c_str()));
+    const std::vector<u8> code = { 0x40, 0x48, 0x60 }; // inc ax, dec ax, not 8086
+    ServerStatus status;
+    std::string text;
+    ASSERT_TRUE(client.Disassemble(ByteSpan{code.data(), code.size()}, status, text));
+    EXPECT_EQ(status, ServerStatus::DECODE_FAILED);
+    EXPECT_EQ(text, "inc ax\ndec ax\n");
+
+    std::vector<u8> huge(64 * 1024 + 1, 0x90);
+    ASSERT_TRUE(client.Disassemble(ByteSpan{huge.data(), huge.size()}, status, text));
+    EXPECT_EQ(status, ServerStatus::TOO_LARGE);
+    // and the connection is closed
+    EXPECT_FALSE(client.Disassemble(ByteSpan{code.data(), code.size()}, status, text));
+}
+
+TEST_F(ServerTest, ConcurrentClients) {
+    // more clients than workers, their requests take turns on the workers
+    std::vector<u8> code = ReadAsmFile("all_supported");
+    std::string expected = Disassemble(code);
+    std::vector<std::thread> clients;
+    std::vector<int> numCorrect(8, 0);
+    for (u32 i = 0; i < numCorrect.size(); i++) {
+        clients.emplace_back([&, i]() {
+            Client client;
+            if (!client.Connect(socketPath.c_str())) {
+                return;
+            }
+            for (u32 rep = 0; rep < 20; rep++) {
+                ServerStatus status;
+                std::string text;
+                if (client.Disassemble(ByteSpan{code.data(), code.size()}, status, text) &&
+                    status == ServerStatus::OK && text == expected) {
+                    numCorrect[i]++;
+                }
+            }
+        });
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    for (u32 i = 0; i < numCorrect.size(); i++) {
+        EXPECT_EQ(numCorrect[i], 20) << "client " << i;
+    }
+}
+TEST_F(ServerTest, IdleClientsHoldNoWorkers) {
+    // a client per worker that connects and sends nothing
+    std::vector<int> idleFds;
+    for (u32 i = 0; i < NUM_TEST_WORKERS; i++) {
+        idleFds.push_back(ConnectRaw(socketPath));
+        ASSERT_GE(idleFds.back(), 0);
+    }
+
+    std::vector<u8> code = ReadAsmFile("add");
+    Client client;
+    ASSERT_TRUE(client.Connect(socketPath.c_str()));
+    auto start = std::chrono::steady_clock::now();
+    ServerStatus status;
+    std::string text;
+    ASSERT_TRUE(client.Disassemble(ByteSpan{code.data(), code.size()}, status, text));
+    EXPECT_EQ(status, ServerStatus::OK);
+    EXPECT_EQ(text, Disassemble(code));
+    // answered straight away, not once the idle clients timed out
+    EXPECT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(STALL_TIMEOUT_MS));
+
+    // and the idle connections are still open for requests of their own
+    u8 emptyRequest[4] = {};
+    u8 response[5];
+    for (int fd : idleFds) {
+        ASSERT_EQ(send(fd, emptyRequest, sizeof(emptyRequest), 0), 4);
+        ASSERT_EQ(recv(fd, response, sizeof(response), MSG_WAITALL), 5);
+        EXPECT_EQ(response[0], (u8)ServerStatus::OK);
+        close(fd);
+    }
+}
+
+TEST_F(ServerTest, StalledRequestsAreDropped) {
+    // a client per worker that starts a request and never finishes it
+    std::vector<int> stalledFds;
+    for (u32 i = 0; i < NUM_TEST_WORKERS; i++) {
+        stalledFds.push_back(ConnectRaw(socketPath));
+        ASSERT_GE(stalledFds.back(), 0);
+        u8 partialSize[2] = { 0x10, 0x00 };
+        ASSERT_EQ(send(stalledFds.back(), partialSize, sizeof(partialSize), 0), 2);
+    }
+
+    // served once the stalled requests time out and free their workers
+    std::vector<u8> code = ReadAsmFile("add");
+    Client client;
+    ASSERT_TRUE(client.Connect(socketPath.c_str()));
+    ServerStatus status;
+    std::string text;
+    ASSERT_TRUE(client.Disassemble(ByteSpan{code.data(), code.size()}, status, text));
+    EXPECT_EQ(status, ServerStatus::OK);
+    EXPECT_EQ(text, Disassemble(code));
+
+    for (int fd : stalledFds) {
+        u8 byte;
+        // closed by the server
+        EXPECT_EQ(recv(fd, &byte, 1, 0), 0);
+        close(fd);
+    }
+}
+
+TEST_F(ServerTest, RunningServerIsNotReplaced) {
+    ServerOptions options;
+    options.socketPath = socketPath.c_str();
+    {
+        Server other(options, DisassembleText);
+        EXPECT_FALSE(other.Start());
+    }
+    // the first server still has its socket
+    std::vector<u8> code = ReadAsmFile("add");
+    Client client;
+    ASSERT_TRUE(client.Connect(socketPath.c_str()));
+    ServerStatus status;
+    std::string text;
+    ASSERT_TRUE(client.Disassemble(ByteSpan{code.data(), code.size()}, status, text));
+    EXPECT_EQ(text, Disassemble(code));
+}
+
+static std::string GetTestSocketPath(const char *name) {
+    return (std::filesystem::temp_directory_path() /
+            ("dis86_test_" + std::to_string(getpid()) + "_" + name)).string();
+}
+
+TEST(SERVER_TEST, LeavesFilesThatAreNotItsSocket) {
+    std::string path = GetTestSocketPath("file");
+    std::ofstream(path) << "keep";
+    ServerOptions options;
+    options.socketPath = path.c_str();
+    {
+        Server server(options, DisassembleText);
+        EXPECT_FALSE(server.Start());
+    }
+    EXPECT_EQ(ReadFileString(path), "keep");
+
+    // replaced after Start, the server's destructor leaves the new file
+    std::filesystem::remove(path);
+    {
+        Server server(options, DisassembleText);
+        ASSERT_TRUE(server.Start());
+        std::filesystem::remove(path);
+        std::ofstream(path) << "keep";
+    }
+    EXPECT_EQ(ReadFileString(path), "keep");
+    std::filesystem::remove(path);
+}
+
+TEST(SERVER_TEST, ReplacesStaleSocket) {
+    std::string path = GetTestSocketPath("stale.sock");
+    // bound but never listened on, like the socket of a server that died
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_EQ(bind(fd, (sockaddr *)&address, sizeof(address)), 0);
+    close(fd);
+    ASSERT_TRUE(std::filesystem::exists(path));
+
+    ServerOptions options;
+    options.socketPath = path.c_str();
+    {
+        Server server(options, DisassembleText);
+        EXPECT_TRUE(server.Start());
+        int clientFd = ConnectRaw(path);
+        EXPECT_GE(clientFd, 0);
+        close(clientFd);
+    }
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
+#endif
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dis86_stats.h>
+#include "test_util.h"
+
+TEST(STATS_TEST, WritesTableAndJson) {
+    DecodeStats stats = {};
+    stats.numInsts = 4;
+    stats.numBytes = 10;
+    stats.formatAttempts[0] = 8;
+    stats.formatMatches[0] = 4;
+    stats.decodeHistogram[5] = 4;
+
+    std::ostringstream table;
+    WriteStats(stats, false, table);
+    EXPECT_NE(table.str().find("instructions  4\n"), std::string::npos) << table.str();
+    EXPECT_NE(table.str().find("2.50 per instruction"), std::string::npos) << table.str();
+    EXPECT_NE(table.str().find("50.00%"), std::string::npos) << table.str();
+    // formats that were never tried are left out
+    EXPECT_EQ(table.str().find("\n     1  "), std::string::npos) << table.str();
+
+    std::ostringstream json;
+    WriteStats(stats, true, json);
+    EXPECT_EQ(json.str().rfind("{\"instructions\": 4, \"bytes\": 10, ", 0), 0u) << json.str();
+    EXPECT_NE(json.str().find("{\"index\": 0, \"op\": \"mov\", \"attempts\": 8, \"matches\": 4}"),
+              std::string::npos) << json.str();
+}
+
+#ifdef DIS86_STATS
+
+TEST(STATS_TEST, CountsEveryThread) {
+    std::vector<u8> file = ReadAsmFile("all_supported");
+    ByteSpan span = {file.data(), file.size()};
+    ResetStats();
+
+    u64 numInsts = 0;
+    InstStream instStream(span);
+    OutputBuffer out;
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        inst.Format(out);
+        numInsts++;
+    }
+    std::thread other([&]() {
+        InstStream otherStream(span);
+        while (otherStream.NextInstructionLinear()) {}
+    });
+    other.join();
+
+    DecodeStats stats = CollectStats();
+    EXPECT_EQ(stats.numInsts, numInsts * 2);
+    EXPECT_EQ(stats.numBytes, file.size() * 2);
+    EXPECT_EQ(stats.numFormatted, numInsts);
+    u64 numMatches = 0;
+    u64 numAttempts = 0;
+    u64 numTimed = 0;
+    for (u32 i = 0; i < NUM_FORMATS; i++) {
+        numMatches += stats.formatMatches[i];
+        numAttempts += stats.formatAttempts[i];
+    }
+    for (u64 count : stats.decodeHistogram) {
+        numTimed += count;
+    }
+    EXPECT_EQ(numMatches, numInsts * 2);
+    EXPECT_GT(numAttempts, numMatches);
+    EXPECT_EQ(numTimed, numInsts * 2);
+    EXPECT_GT(stats.phaseTicks[(u8)StatsPhase::DECODE], 0u);
+
+    ResetStats();
+    EXPECT_EQ(CollectStats().numInsts, 0u);
+}
+
+TEST(STATS_TEST, CutOffInstructionIsNotAMatch) {
+    // mov ax, 0x1234 missing its last byte
+    const u8 bytes[] = { 0xb8, 0x34 };
+    for (bool linear : {false, true}) {
+        ResetStats();
+        InstStream instStream(ByteSpan{bytes, sizeof(bytes)});
+        EXPECT_FALSE(linear ? instStream.NextInstructionLinear() : instStream.NextInstruction());
+        EXPECT_TRUE(instStream.Failed());
+
+        DecodeStats stats = CollectStats();
+        const DecodeCounters& counters = instStream.GetDecodeCounters();
+        u64 numMatches = 0;
+        u64 numAttempts = 0;
+        for (u32 i = 0; i < NUM_FORMATS; i++) {
+            numMatches += stats.formatMatches[i];
+            numAttempts += stats.formatAttempts[i];
+        }
+        EXPECT_EQ(stats.numInsts, 0u) << linear;
+        EXPECT_EQ(numMatches, 0u) << linear;
+        EXPECT_EQ(counters.numInsts, 0u) << linear;
+        EXPECT_EQ(numAttempts, counters.numProbes) << linear;
+        EXPECT_GT(counters.numProbes, 0u) << linear;
+    }
+    ResetStats();
+}
+
+#endif
@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <dis86_instruction_stream.h>
+#include "test_util.h"
+
+// hands out the data one byte per underflow, like a slow pipe
+class OneByteStreamBuf : public std::streambuf {
+public:
+    OneByteStreamBuf(const std::string& data) : data(data), pos(0) {}
+
+protected:
+    int_type underflow() override {
+        if (pos >= data.size()) {
+            return traits_type::eof();
+        }
+        current = data[pos++];
+        setg(&current, &current, &current + 1);
+        return traits_type::to_int_type(current);
+    }
+
+private:
+    std::string data;
+    std::size_t pos;
+    char current;
+};
+
+static std::vector<Instruction> DecodeAll(InstStream& instStream) {
+    std::vector<Instruction> insts;
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        insts.push_back(inst);
+    }
+    return insts;
+}
+
+TEST(STREAM_TEST, OneByteChunks) {
+    std::string bytes = ReadAsmString("all_supported");
+    ASSERT_FALSE(bytes.empty());
+
+    std::istringstream wholeStream(bytes);
+    InstStream wholeInstStream(&wholeStream);
+    std::vector<Instruction> expectedInsts = DecodeAll(wholeInstStream);
+    ASSERT_FALSE(expectedInsts.empty());
+
+    // small buffers make instructions straddle refills at every offset
+    for (u32 bufferSize = MAX_INST_BYTES; bufferSize <= 32; bufferSize++) {
+        OneByteStreamBuf buf(bytes);
+        std::istream byteStream(&buf);
+        InstStream instStream(&byteStream, bufferSize);
+        std::vector<Instruction> insts = DecodeAll(instStream);
+
+        ASSERT_EQ(insts.size(), expectedInsts.size()) << "buffer size " << bufferSize;
+        for (u32 i = 0; i < insts.size(); i++) {
+            EXPECT_EQ(insts[i], expectedInsts[i])
+                << "instruction mismatch, buffer size " << bufferSize
+                << ", instruction index:" << i;
+        }
+    }
+}
+
+TEST(STREAM_TEST, InputLargerThanBuffer) {
+    std::string file = ReadAsmString("all_supported");
+    ASSERT_FALSE(file.empty());
+
+    std::istringstream fileStream(file);
+    InstStream fileInstStream(&fileStream);
+    size_t instsPerFile = DecodeAll(fileInstStream).size();
+
+    // well past the old fixed 256 KiB buffer
+    std::string bytes;
+    u32 numCopies = 0;
+    while (bytes.size() < 1024 * 1024) {
+        bytes += file;
+        numCopies++;
+    }
+
+    std::istringstream byteStream(bytes);
+    InstStream instStream(&byteStream);
+    EXPECT_EQ(DecodeAll(instStream).size(), instsPerFile * numCopies);
+}
+
+TEST(STREAM_TEST, SourcesAgree) {
+    std::string bytes = ReadAsmString("all_supported");
+    ASSERT_FALSE(bytes.empty());
+
+    std::istringstream byteStream(bytes);
+    InstStream streamInstStream(&byteStream);
+    std::vector<Instruction> expectedInsts = DecodeAll(streamInstStream);
+
+    InstStream spanInstStream(ByteSpan{(const u8 *)bytes.data(), bytes.size()});
+    std::vector<Instruction> spanInsts = DecodeAll(spanInstStream);
+
+    MappedFileSource mappedFile(GetAsmPath("all_supported").c_str());
+    ASSERT_TRUE(mappedFile.IsOpen());
+    InstStream mappedInstStream(&mappedFile);
+    std::vector<Instruction> mappedInsts = DecodeAll(mappedInstStream);
+
+    ASSERT_EQ(spanInsts.size(), expectedInsts.size());
+    ASSERT_EQ(mappedInsts.size(), expectedInsts.size());
+    for (u32 i = 0; i < expectedInsts.size(); i++) {
+        EXPECT_EQ(spanInsts[i], expectedInsts[i]) << "instruction index:" << i;
+        EXPECT_EQ(mappedInsts[i], expectedInsts[i]) << "instruction index:" << i;
+    }
+}
+
+TEST(STREAM_TEST, TruncatedLastInstruction) {
+    // mov ax, bx then a mov [imm16], imm16 missing its last bytes
+    const u8 bytes[] = { 0x89, 0xd8, 0xc7, 0x06, 0x00 };
+
+    InstStream instStream(ByteSpan{bytes, ARR_SIZE(bytes)});
+    std::vector<Instruction> insts = DecodeAll(instStream);
+
+    EXPECT_EQ(insts.size(), 1u);
+    EXPECT_TRUE(instStream.Failed());
+    EXPECT_EQ(instStream.GetOffset(), 2u);
+}
+
+TEST(STREAM_TEST, OffsetsAndBytes) {
+    std::string bytes = ReadAsmString("all_supported");
+    ASSERT_FALSE(bytes.empty());
+
+    // the instruction bytes must survive refills at every offset
+    for (u32 bufferSize = MAX_INST_BYTES; bufferSize <= 16; bufferSize++) {
+        OneByteStreamBuf buf(bytes);
+        std::istream byteStream(&buf);
+        InstStream instStream(&byteStream, bufferSize);
+        u64 offset = 0;
+        Instruction inst;
+        while (inst = instStream.NextInstruction()) {
+            ASSERT_EQ(inst.GetOffset(), offset) << "buffer size " << bufferSize;
+            ASSERT_GE(inst.GetLength(), 1u);
+            ASSERT_LE(inst.GetLength(), MAX_INST_BYTES);
+            EXPECT_EQ(std::string((const char *)instStream.GetInstBytes(), inst.GetLength()),
+                      bytes.substr(offset, inst.GetLength()))
+                << "buffer size " << bufferSize << ", offset " << offset;
+            offset += inst.GetLength();
+            EXPECT_EQ(instStream.GetOffset(), offset);
+        }
+        EXPECT_EQ(offset, bytes.size());
+    }
+}
+
+TEST(STREAM_TEST, Listing) {
+    // mov [bx + 1000], word 1234 after a two byte mov
+    const u8 bytes[] = { 0x89, 0xd8, 0xc7, 0x87, 0xe8, 0x03, 0xd2, 0x04 };
+    InstStream instStream(ByteSpan{bytes, ARR_SIZE(bytes)}, 0x28);
+
+    OutputBuffer out;
+    Instruction inst;
+    while (inst = instStream.NextInstruction()) {
+        inst.FormatListing(out, instStream.GetInstBytes());
+    }
+    EXPECT_EQ(std::string(out.Data(), out.Size()),
+        "00000028  89 d8              mov ax, bx\n"
+        "0000002a  c7 87 e8 03 d2 04  mov [bx + 1000], word 1234\n");
+}
+
+TEST(STREAM_TEST, OneAttemptPerInstruction) {
+    std::string bytes = ReadAsmString("all_supported");
+    ByteSpan span = {(const u8 *)bytes.data(), bytes.size()};
+
+    InstStream instStream(span);
+    u64 numInsts = DecodeAll(instStream).size();
+    DecodeCounters counters = instStream.GetDecodeCounters();
+    EXPECT_EQ(counters.numInsts, numInsts);
+    EXPECT_EQ(counters.numProbes, numInsts);
+    EXPECT_EQ(counters.numAttempts, numInsts);
+
+    // the interpreter compares against many formats but only reads the
+    // fields of the one that matches
+    InstStream linearStream(span);
+    while (linearStream.NextInstructionLinear()) {}
+    counters = linearStream.GetDecodeCounters();
+    EXPECT_EQ(counters.numInsts, numInsts);
+    EXPECT_GT(counters.numProbes, numInsts);
+    EXPECT_EQ(counters.numAttempts, numInsts);
+
+    linearStream.ResetDecodeCounters();
+    EXPECT_EQ(linearStream.GetDecodeCounters().numInsts, 0u);
+
+    // a mismatch on the second byte (aam is d4 0a) doesn't move the stream
+    const u8 aamBad[] = { 0xd4, 0x0b };
+    InstStream badStream(ByteSpan{aamBad, sizeof(aamBad)});
+    EXPECT_FALSE(badStream.NextInstruction());
+    EXPECT_TRUE(badStream.Failed());
+    EXPECT_EQ(badStream.GetOffset(), 0u);
+    EXPECT_EQ(badStream.GetDecodeCounters().numAttempts, 0u);
+}
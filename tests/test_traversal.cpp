@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dis86_traversal.h>
+#include <dis86_work_deque.h>
+
+static std::string FormatTraversal(Traversal& traversal) {
+    OutputBuffer out;
+    traversal.Format(out);
+    return std::string(out.Data(), out.Size());
+}
+
+TEST(TRAVERSAL_TEST, SkipsData) {
+    const std::vector<u8> image = {
+        0xeb, 0x03,       // jmp over the data
+        0x60, 0x61, 0x62, // not 8086 instructions
+        0x40,             // inc ax
+        0xc3,             // ret
+        0xff, 0xff,       // never reached
+    };
+    Traversal traversal(ByteSpan{image.data(), image.size()});
+    traversal.AddEntryPoint(0);
+    traversal.Run();
+
+    const std::vector<BasicBlock>& blocks = traversal.GetBlocks();
+    ASSERT_EQ(blocks.size(), 2u);
+    EXPECT_EQ(blocks[0].start, 0u);
+    EXPECT_EQ(blocks[0].end, 2u);
+    EXPECT_EQ(blocks[0].numInsts, 1u);
+    EXPECT_EQ(blocks[1].start, 5u);
+    EXPECT_EQ(blocks[1].end, 7u);
+    EXPECT_EQ(blocks[1].numInsts, 2u);
+
+    for (u64 offset = 0; offset < image.size(); offset++) {
+        bool isCode = offset < 2 || (offset >= 5 && offset < 7);
+        EXPECT_EQ(traversal.IsCode(offset), isCode) << "offset " << offset;
+    }
+    EXPECT_TRUE(traversal.IsInstStart(5));
+    EXPECT_FALSE(traversal.IsInstStart(1));
+
+    EXPECT_EQ(FormatTraversal(traversal),
+        "; code 00000000\n"
+        "jmp $+5\n"
+        "; data 00000002\n"
+        "db 96, 97, 98\n"
+        "; code 00000005\n"
+        "inc ax\n"
+        "ret \n"
+        "; data 00000007\n"
+        "db 255, 255\n");
+}
+
+TEST(TRAVERSAL_TEST, SplitsBlocksAtBranchesAndTargets) {
+    const std::vector<u8> image = {
+        0xb9, 0x03, 0x00, // 0: mov cx, word 3
+        0x40,             // 3: inc ax
+        0x43,             // 4: inc bx
+        0xe2, 0xfc,       // 5: loop to 3
+        0x74, 0x01,       // 7: je to 10
+        0x48,             // 9: dec ax
+        0xc3,             // 10: ret
+    };
+    Traversal traversal(ByteSpan{image.data(), image.size()});
+    traversal.AddEntryPoint(0);
+    traversal.Run();
+
+    struct { u64 start, end; u32 numInsts; } expected[] = {
+        { 0, 3, 1 },  // up to the loop target
+        { 3, 7, 3 },  // loop body, ends at the loop
+        { 7, 9, 1 },  // je
+        { 9, 10, 1 }, // fall through of je
+        { 10, 11, 1 } // je target
+    };
+    const std::vector<BasicBlock>& blocks = traversal.GetBlocks();
+    ASSERT_EQ(blocks.size(), ARR_SIZE(expected));
+    for (u32 i = 0; i < blocks.size(); i++) {
+        EXPECT_EQ(blocks[i].start, expected[i].start) << "block " << i;
+        EXPECT_EQ(blocks[i].end, expected[i].end) << "block " << i;
+        EXPECT_EQ(blocks[i].numInsts, expected[i].numInsts) << "block " << i;
+    }
+}
+
+TEST(TRAVERSAL_TEST, EntryPointsAndCalls) {
+    const std::vector<u8> image = {
+        0xe8, 0x03, 0x00, // 0: call 6
+        0xc3,             // 3: ret
+        0x60, 0x60,       // 4: data
+        0x40,             // 6: inc ax
+        0xc3,             // 7: ret
+        0x60,             // 8: data
+        0x48,             // 9: dec ax, only reachable as an entry point
+        0xcb,             // 10: retf
+    };
+    Traversal traversal(ByteSpan{image.data(), image.size()});
+    traversal.AddEntryPoint(0);
+    traversal.AddEntryPoint(9);
+    // out of range entry points are ignored
+    traversal.AddEntryPoint(100);
+    traversal.Run();
+
+    const std::vector<BasicBlock>& blocks = traversal.GetBlocks();
+    ASSERT_EQ(blocks.size(), 4u);
+    EXPECT_EQ(blocks[0].start, 0u);
+    EXPECT_EQ(blocks[1].start, 3u);
+    EXPECT_EQ(blocks[2].start, 6u);
+    EXPECT_EQ(blocks[3].start, 9u);
+    EXPECT_FALSE(traversal.IsCode(4));
+    EXPECT_FALSE(traversal.IsCode(8));
+}
+
+TEST(TRAVERSAL_TEST, JumpIntoDecodedCode) {
+    // the second entry runs into the first one's code, which is not decoded
+    // again but does start a block there
+    const std::vector<u8> image = {
+        0x40,       // 0: inc ax
+        0x43,       // 1: inc bx
+        0xc3,       // 2: ret
+        0xeb, 0xfc, // 3: jmp to 1
+    };
+    Traversal traversal(ByteSpan{image.data(), image.size()});
+    traversal.AddEntryPoint(0);
+    traversal.AddEntryPoint(3);
+    traversal.Run();
+
+    const std::vector<BasicBlock>& blocks = traversal.GetBlocks();
+    ASSERT_EQ(blocks.size(), 3u);
+    EXPECT_EQ(blocks[0].start, 0u);
+    EXPECT_EQ(blocks[0].numInsts, 1u);
+    EXPECT_EQ(blocks[1].start, 1u);
+    EXPECT_EQ(blocks[1].numInsts, 2u);
+    EXPECT_EQ(blocks[2].start, 3u);
+}
+
+TEST(TRAVERSAL_TEST, MatchesLinearSweepOnPlainCode) {
+    // straight line code with no jumps decodes the same as a linear sweep
+    std::vector<u8> image;
+    for (u32 i = 0; i < 1000; i++) {
+        image.insert(image.end(), { 0x89, 0xd8, 0x05, 0x34, 0x12, 0x40 });
+    }
+    Traversal traversal(ByteSpan{image.data(), image.size()});
+    traversal.AddEntryPoint(0);
+    traversal.Run();
+
+    ASSERT_EQ(traversal.GetBlocks().size(), 1u);
+    EXPECT_EQ(traversal.GetBlocks()[0].numInsts, 3000u);
+    EXPECT_EQ(traversal.GetBlocks()[0].end, image.size());
+}
+
+static void ExpectSameTraversal(const Traversal& expected, const Traversal& actual, u64 size) {
+    const std::vector<BasicBlock>& expectedBlocks = expected.GetBlocks();
+    const std::vector<BasicBlock>& actualBlocks = actual.GetBlocks();
+    ASSERT_EQ(actualBlocks.size(), expectedBlocks.size());
+    for (u32 i = 0; i < expectedBlocks.size(); i++) {
+        ASSERT_EQ(actualBlocks[i].start, expectedBlocks[i].start) << "block " << i;
+        ASSERT_EQ(actualBlocks[i].end, expectedBlocks[i].end) << "block " << i;
+        ASSERT_EQ(actualBlocks[i].numInsts, expectedBlocks[i].numInsts) << "block " << i;
+    }
+    for (u64 offset = 0; offset < size; offset++) {
+        ASSERT_EQ(actual.IsCode(offset), expected.IsCode(offset)) << "offset " << offset;
+        ASSERT_EQ(actual.IsInstStart(offset), expected.IsInstStart(offset)) << "offset " << offset;
+    }
+}
+
+TEST(TRAVERSAL_TEST, ParallelMatchesSequential) {
+    // random bytes are full of branches, invalid opcodes and decodes that
+    // overlap each other, which is where scheduling could leak into the result
+    std::mt19937 rng(8086);
+    std::vector<u8> image(64 * 1024);
+    for (u8& byte : image) {
+        byte = (u8)rng();
+    }
+    ByteSpan span = {image.data(), image.size()};
+    auto addEntryPoints = [](Traversal& traversal) {
+        for (u64 offset = 0; offset < 64 * 1024; offset += 97) {
+            traversal.AddEntryPoint(offset);
+        }
+    };
+
+    Traversal sequential(span);
+    addEntryPoints(sequential);
+    sequential.Run();
+    ASSERT_GT(sequential.GetBlocks().size(), 500u);
+
+    for (u32 numThreads : { 1, 2, 3, 8 }) {
+        for (u32 rep = 0; rep < 3; rep++) {
+            Traversal parallel(span);
+            addEntryPoints(parallel);
+            parallel.Run(numThreads);
+            SCOPED_TRACE(numThreads);
+            ExpectSameTraversal(sequential, parallel, image.size());
+        }
+    }
+}
+
+TEST(TRAVERSAL_TEST, DequeHandsOutEachValueOnce) {
+    const u64 numValues = 100000;
+    WorkDeque deque;
+    std::vector<std::atomic<u32>> seen(numValues);
+    std::atomic<bool> done(false);
+
+    std::vector<std::thread> thieves;
+    for (u32 i = 0; i < 3; i++) {
+        thieves.emplace_back([&]() {
+            u64 value;
+            while (!done.load()) {
+                if (deque.Steal(value)) {
+                    seen[value]++;
+                }
+            }
+        });
+    }
+    // the owner pops some of its own work as it goes, like a worker does
+    u64 value;
+    for (u64 i = 0; i < numValues; i++) {
+        deque.Push(i);
+        if (i % 3 == 0 && deque.Pop(value)) {
+            seen[value]++;
+        }
+    }
+    while (deque.Pop(value)) {
+        seen[value]++;
+    }
+    done.store(true);
+    for (std::thread& thief : thieves) {
+        thief.join();
+    }
+    for (u64 i = 0; i < numValues; i++) {
+        ASSERT_EQ(seen[i].load(), 1u) << "value " << i;
+    }
+}
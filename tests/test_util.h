@@ -0,0 +1,24 @@
+#pragma once
+// helpers shared by the tests. DIS86_ASM_DIR is defined in CMakeLists.txt and
+// points at the assembled inputs in tests/asm.
+#include <string>
+#include <vector>
+#include <dis86_num_types.h>
+#include <dis86_batch.h>
+
+inline std::string GetAsmPath(const char *name) {
+    return std::string(DIS86_ASM_DIR "/") + name;
+}
+
+// empty if the file can't be read
+inline std::vector<u8> ReadAsmFile(const char *name) {
+    std::vector<u8> bytes;
+    ReadWholeFile(GetAsmPath(name), bytes);
+    return bytes;
+}
+
+// the same bytes as a string, for decoding through a std::istream
+inline std::string ReadAsmString(const char *name) {
+    std::vector<u8> bytes = ReadAsmFile(name);
+    return std::string(bytes.begin(), bytes.end());
+}